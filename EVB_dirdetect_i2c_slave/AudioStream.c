@@ -0,0 +1,271 @@
+#include <string.h>
+#include "Platform.h"
+#include "AudioStream.h"
+
+#if DIRDETECT_AUDIO_STREAM
+
+// The body's packets, not this project's (see AudioStream.h).
+#include "../Shared/Nuvoton/Packet.h"
+
+//
+// Local Variables and Defines
+//
+
+#define AUDIO_STREAM_DECIMATION_SHIFT	((AUDIO_STREAM_DECIMATION == 8) ? 3 : 2)
+#define AUDIO_STREAM_CIC_SHIFT			(2*AUDIO_STREAM_DECIMATION_SHIFT)	// the decimator's gain is AUDIO_STREAM_DECIMATION squared
+#define AUDIO_STREAM_QUEUE_MASK			(AUDIO_STREAM_QUEUE - 1)
+#define AUDIO_STREAM_PERIOD				(SAMPLE_FREQUENCY/AUDIO_STREAM_RATE)	// ring samples the master waits between packets
+
+// IMA ADPCM.
+static const INT16 s_ai16Step[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+	253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+	1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+	3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+	12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+static const INT8 s_ai8IndexStep[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+static volatile BOOL s_bOn = FALSE;
+
+// Packets waiting for the master, s_u8Tail..s_u8Head-1 (both counting up
+// and wrapping).  The detector adds them and the I2C interrupt takes them,
+// each with the other shut out.
+static PACKETData s_asQueue[AUDIO_STREAM_QUEUE];
+static volatile UINT8 s_u8Head = 0;
+static volatile UINT8 s_u8Tail = 0;
+static volatile UINT16 s_u16Dropped = 0;
+
+// The packet the master is reading, only touched by the I2C interrupt.
+// s_u8Byte is its next byte, counting the length and checksum.
+static PACKETData s_sSending;
+static UINT8 s_u8Byte = 0;
+
+// The rate cap, in ring samples.  The detector counts the samples it codes,
+// the I2C interrupt those it has been given packets for, at
+// AUDIO_STREAM_PERIOD each.
+static volatile UINT32 s_u32Earned = 0;
+static UINT32 s_u32Spent = 0;
+
+// The packet being filled, only touched by the detector.
+static PACKETData s_sPacket;
+static UINT8 s_u8Sequence = 0;
+static UINT8 s_u8Coded = 0;				// samples in s_sPacket, 0 for none
+static INT16 s_i16Predicted;
+static UINT8 s_u8StepIndex = 0;			// carried from packet to packet, so each starts on a good step
+
+// The decimator, a second order CIC: two integrators at the ring's rate,
+// allowed to wrap, and two combs at the rate sent.  What lies between half
+// the rate sent and the rate sent folds back over the band; a single box
+// filter only takes it 4 to 9dB down from 2.95 to 4.2kHz, two in a row
+// twice that.
+static UINT32 s_au32Integrator[2];
+static UINT32 s_au32Comb[2];			// each comb's input at the last sample sent
+static UINT8 s_u8Summed = 0;
+
+//
+// Local Functions
+//
+
+// Code one sample, returning its nibble.
+static UINT8 adpcm_encode(INT16 i16Sample)
+{
+	INT32 i32Diff = (INT32) i16Sample - s_i16Predicted;
+	INT32 i32Step = s_ai16Step[s_u8StepIndex];
+	INT32 i32Delta = i32Step >> 3;
+	INT32 i32Predicted;
+	INT8 i8Index;
+	UINT8 u8Code = 0;
+
+	if (i32Diff < 0) {
+		u8Code = 8;
+		i32Diff = -i32Diff;
+	}
+	if (i32Diff >= i32Step) {
+		u8Code |= 4;
+		i32Diff -= i32Step;
+		i32Delta += i32Step;
+	}
+	i32Step >>= 1;
+	if (i32Diff >= i32Step) {
+		u8Code |= 2;
+		i32Diff -= i32Step;
+		i32Delta += i32Step;
+	}
+	i32Step >>= 1;
+	if (i32Diff >= i32Step) {
+		u8Code |= 1;
+		i32Delta += i32Step;
+	}
+
+	// Track what the decoder will make of it.
+	i32Predicted = s_i16Predicted + ((u8Code & 8) ? -i32Delta : i32Delta);
+	if (i32Predicted > 32767)
+		i32Predicted = 32767;
+	else if (i32Predicted < -32768)
+		i32Predicted = -32768;
+	s_i16Predicted = (INT16) i32Predicted;
+
+	i8Index = (INT8) s_u8StepIndex + s_ai8IndexStep[u8Code & 7];
+	if (i8Index < 0)
+		i8Index = 0;
+	else if (i8Index > 88)
+		i8Index = 88;
+	s_u8StepIndex = (UINT8) i8Index;
+	return u8Code;
+}
+
+// Add one decimated sample to the packet, queueing it when it is full.
+static void add_sample(INT16 i16Sample)
+{
+	UINT8 *pu8Data = s_sPacket.buffer;
+
+	// Each packet starts with a sample sent whole.
+	if (s_u8Coded == 0) {
+		pu8Data[0] = 0;
+		packetSetDest(&s_sPacket, PACKET_LOC_BTLE);
+		packetSetSource(&s_sPacket, PACKET_LOC_NVT2);
+		packetSetType(&s_sPacket, PACKET_TYPE_AUDIO);
+		pu8Data[PACKET_AUDIO_SEQUENCE] = s_u8Sequence++;
+		pu8Data[PACKET_AUDIO_PREDICTOR] = (UINT8) i16Sample;
+		pu8Data[PACKET_AUDIO_PREDICTOR + 1] = (UINT8) ((UINT16) i16Sample >> 8);
+		pu8Data[PACKET_AUDIO_STEP_INDEX] = s_u8StepIndex;
+		s_i16Predicted = i16Sample;
+		s_u8Coded = 1;
+		return;
+	}
+
+	// The rest two to a byte, low nibble first.
+	pu8Data += PACKET_AUDIO_DATA + ((s_u8Coded - 1) >> 1);
+	if (s_u8Coded & 1)
+		*pu8Data = adpcm_encode(i16Sample);
+	else
+		*pu8Data |= adpcm_encode(i16Sample) << 4;
+	if (++s_u8Coded < PACKET_AUDIO_SAMPLES)
+		return;
+
+	s_sPacket.length = PACKET_BUF_LENGTH;
+	packetSetChecksum(&s_sPacket);
+	s_u8Coded = 0;
+
+	// Make room by dropping the oldest packet if the master hasn't kept up.
+	__disable_irq();
+	if ((UINT8) (s_u8Head - s_u8Tail) >= AUDIO_STREAM_QUEUE) {
+		s_u8Tail++;
+		s_u16Dropped++;
+	}
+	memcpy(&s_asQueue[s_u8Head & AUDIO_STREAM_QUEUE_MASK], &s_sPacket, sizeof(PACKETData));
+	s_u8Head++;
+	__enable_irq();
+}
+
+// Take the packet the master reads next into s_sSending, or an empty one
+// if there is none or it is over AUDIO_STREAM_RATE.
+static void next_packet(void)
+{
+	UINT32 u32Credit = s_u32Earned - s_u32Spent;
+
+	if (u32Credit > AUDIO_STREAM_BURST*AUDIO_STREAM_PERIOD) {
+		s_u32Spent = s_u32Earned - AUDIO_STREAM_BURST*AUDIO_STREAM_PERIOD;
+		u32Credit = AUDIO_STREAM_BURST*AUDIO_STREAM_PERIOD;
+	}
+	if ((s_u8Tail == s_u8Head) || (u32Credit < AUDIO_STREAM_PERIOD)) {
+		s_sSending.length = 0;
+		return;
+	}
+	s_u32Spent += AUDIO_STREAM_PERIOD;
+	memcpy(&s_sSending, &s_asQueue[s_u8Tail & AUDIO_STREAM_QUEUE_MASK], sizeof(PACKETData));
+	s_u8Tail++;
+}
+
+//
+// Global Functions
+//
+
+void audioStreamStart(void)
+{
+	if (!s_bOn) {
+		s_u8Tail = s_u8Head;
+		s_u16Dropped = 0;
+		s_u32Spent = s_u32Earned;
+		s_bOn = TRUE;
+		dirDetectWake();
+	}
+	s_u8Byte = 0;
+}
+
+void audioStreamStop(void)
+{
+	s_bOn = FALSE;
+}
+
+BOOL audioStreamIsOn(void)
+{
+	return s_bOn;
+}
+
+UINT8 audioStreamReadByte(void)
+{
+	UINT8 u8Byte;
+
+	if (s_u8Byte == 0) {
+		next_packet();
+		u8Byte = s_sSending.length;
+	}
+	else if (s_u8Byte == 1)
+		u8Byte = s_sSending.checksum;
+	else
+		u8Byte = s_sSending.buffer[s_u8Byte - 2];
+
+	// An empty packet is just its length.
+	if ((s_sSending.length == 0) || (++s_u8Byte >= s_sSending.length + 2))
+		s_u8Byte = 0;
+	return u8Byte;
+}
+
+UINT16 audioStreamGetDropped(void)
+{
+	return s_u16Dropped;
+}
+
+void audioStreamPush(const INT16 * const *ppi16Ring, UINT32 u32From, UINT32 u32To, UINT32 u32Mask)
+{
+	const INT16 *pi16Ring = ppi16Ring[AUDIO_STREAM_MIC];
+	UINT32 u32Sample;
+
+	// Start again with the next packet when streaming starts.
+	if (!s_bOn) {
+		s_u8Coded = 0;
+		memset(s_au32Integrator, 0, sizeof(s_au32Integrator));
+		memset(s_au32Comb, 0, sizeof(s_au32Comb));
+		s_u8Summed = 0;
+		return;
+	}
+
+	// Filter the mic down to the streamed rate, with the gain.
+	for(u32Sample = u32From; u32Sample != u32To; u32Sample++) {
+		UINT32 u32Comb;
+		INT32 i32Sample;
+
+		s_au32Integrator[0] += (UINT32) (INT32) pi16Ring[u32Sample & u32Mask];
+		s_au32Integrator[1] += s_au32Integrator[0];
+		if (++s_u8Summed < AUDIO_STREAM_DECIMATION)
+			continue;
+
+		u32Comb = s_au32Integrator[1] - s_au32Comb[0];
+		i32Sample = (INT32) (u32Comb - s_au32Comb[1]);
+		s_au32Comb[0] = s_au32Integrator[1];
+		s_au32Comb[1] = u32Comb;
+		i32Sample = (i32Sample << AUDIO_STREAM_GAIN_SHIFT) >> AUDIO_STREAM_CIC_SHIFT;
+		if (i32Sample > 32767)
+			i32Sample = 32767;
+		else if (i32Sample < -32768)
+			i32Sample = -32768;
+		s_u8Summed = 0;
+		add_sample((INT16) i32Sample);
+	}
+	s_u32Earned += u32To - u32From;
+}
+
+#endif // DIRDETECT_AUDIO_STREAM
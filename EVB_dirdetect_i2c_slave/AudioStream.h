@@ -0,0 +1,72 @@
+#ifndef __AUDIOSTREAM_H
+#define __AUDIOSTREAM_H
+
+#include "Platform.h"
+#include "DirDetect.h"
+
+//
+// Global Defines and Declarations
+//
+
+// Listening in.  Streams one mic, decimated by a second order CIC and IMA
+// ADPCM coded, as PACKET_TYPE_AUDIO packets (see ../Shared/Nuvoton/Packet.h)
+// addressed to PACKET_LOC_BTLE, which the I2C master reads from
+// I2C_REG_STREAM and can pass on to the phone as they are.
+//
+// The master reads a packet as its length byte, then (unless that is 0)
+// the checksum and that many bytes of the packet, as in PACKETData.  A
+// length of 0 means no packet is due: the queue is empty, or the master is
+// reading faster than AUDIO_STREAM_RATE.  Reselecting I2C_REG_STREAM starts
+// again at a packet's length byte.  When the master falls behind, the
+// oldest packet in the queue is dropped to make room; the sequence numbers
+// show the gap and the next packet decodes without it.
+//
+// Like any read of this slave, reading a packet masks the ADC interrupt
+// for as long as it takes (see GPAB_IRQHandler()), so the conversions made
+// meanwhile are missing from the stream and from the detector alike.
+// AUDIO_STREAM_RATE is what bounds that share.
+#ifndef DIRDETECT_AUDIO_STREAM
+#define DIRDETECT_AUDIO_STREAM 0 // build the streamer (about 170 bytes of RAM, and the 768 byte unfiltered ring it shares with DIRDETECT_CAPTURE if DIRDETECT_PREFILTER is on)
+#endif
+
+#define AUDIO_STREAM_MIC			0		// mic streamed (0 to 2 for A to C)
+#define AUDIO_STREAM_DECIMATION		8		// decimation to the rate sent (4 or 8); 8 is 5.9kHz and 190 packets a second, inside AUDIO_STREAM_RATE
+#define AUDIO_STREAM_GAIN_SHIFT		3		// the ring's samples are 12 bits, ADPCM codes 16
+#define AUDIO_STREAM_QUEUE			4		// packets waiting for the master (a power of two)
+#define AUDIO_STREAM_RATE			200		// most packets a second the master is given
+#define AUDIO_STREAM_BURST			2		// packets the master can save up and read back to back
+
+#if (AUDIO_STREAM_DECIMATION != 4) && (AUDIO_STREAM_DECIMATION != 8)
+#error "AUDIO_STREAM_DECIMATION must be 4 or 8"
+#endif
+#if (AUDIO_STREAM_QUEUE & (AUDIO_STREAM_QUEUE - 1))
+#error "AUDIO_STREAM_QUEUE must be a power of two"
+#endif
+
+//
+// Global Functions
+//
+
+#if DIRDETECT_AUDIO_STREAM
+// For the I2C slave.  Start streaming (which keeps the detector awake), or
+// if it already is, go back to the start of a packet.  Stop streaming.
+void audioStreamStart(void);
+void audioStreamStop(void);
+BOOL audioStreamIsOn(void);
+
+// For the I2C slave, a master read of I2C_REG_STREAM: the next byte of the
+// packet being read, as described above.
+UINT8 audioStreamReadByte(void);
+
+// The packets dropped since the stream started.
+UINT16 audioStreamGetDropped(void);
+
+// For the detector, each hop.  Code the samples u32From..u32To-1 of the
+// capture ring (one per mic, indexed with u32Mask) and queue each packet as
+// it fills.
+void audioStreamPush(const INT16 * const *ppi16Ring, UINT32 u32From, UINT32 u32To, UINT32 u32Mask);
+#else
+#define audioStreamIsOn()			FALSE
+#endif
+
+#endif // __AUDIOSTREAM_H
@@ -0,0 +1,240 @@
+#include <string.h>
+#include "Platform.h"
+#include "Capture.h"
+#include "Global.h"
+
+//
+// Global Variables
+//
+
+// The SPI master bus, for SpiFS.c.  Only the recorder uses it, but
+// SpiFS.c is built either way.
+osMutexId spiMasterMutex;
+
+#if DIRDETECT_CAPTURE
+
+#include "Storage/SPIFlash.h"
+#include "SpiFS.h"
+
+osMutexDef(spiMasterMutex);
+
+//
+// Local Variables and Defines
+//
+
+#define CAPTURE_DECIMATION_SHIFT	((CAPTURE_DECIMATION == 4) ? 2 : (CAPTURE_DECIMATION - 1))
+#define CAPTURE_FRAME_SIZE			(NUM_CHANNELS*sizeof(INT16))
+#define CAPTURE_MAX_RECORD			(sizeof(S_CAPTURE_RECORD) + ((DIRDETECT_RING_SIZE >> CAPTURE_DECIMATION_SHIFT) + 1)*CAPTURE_FRAME_SIZE)
+
+static osThreadId s_tidService = NULL;
+static INT32 s_i32ServiceSignals = 0;
+
+static volatile E_CAPTURE_STATE s_eState = eCAPTURE_IDLE;
+static volatile BOOL s_bStartRequested = FALSE;
+static volatile BOOL s_bStopRequested = FALSE;
+static E_CAPTURE_TRIGGER s_eTrigger = eCAPTURE_TRIGGER_ONSET;
+
+// The file, written from the detector thread between captureService()
+// opening and closing it.
+static SPIFS_STREAM s_sStream;
+static S_CAPTURE_HEADER s_sHeader;			// filled in when the file is opened, written when recording starts
+static UINT8 s_u8Dropped = 0;
+
+// The decimator's running sums.
+static INT32 s_ai32Sum[NUM_CHANNELS];
+static UINT8 s_u8Summed = 0;
+
+//
+// Local Functions
+//
+
+static void signal_service(void)
+{
+	if (s_tidService)
+		osSignalSet(s_tidService, s_i32ServiceSignals);
+}
+
+// Open the first of "capture0".."capture7" that isn't there yet.
+static BOOL open_next_file(void)
+{
+	SPIFS_FILE sFile;
+	char acName[SPIFS_FILENAME_LEN] = "capture0";
+	UINT8 u8File;
+
+	for(u8File = 0; u8File<CAPTURE_FILES; u8File++) {
+		acName[7] = '0' + u8File;
+		if (spiFSOpen(acName, FALSE, &sFile)) {
+			spiFSClose(&sFile);
+			continue;
+		}
+		return spiFSStreamOpen(acName, CAPTURE_SECTORS, &s_sStream);
+	}
+	return FALSE;
+}
+
+static void fill_header(void)
+{
+	memset(&s_sHeader, 0, sizeof(s_sHeader));
+	s_sHeader.u32Magic = CAPTURE_MAGIC;
+	s_sHeader.u32SampleRate = SAMPLE_FREQUENCY/CAPTURE_DECIMATION;
+	s_sHeader.u32ScanRate = ADC_SCAN_FREQUENCY;
+	s_sHeader.u8Channels = NUM_CHANNELS;
+	s_sHeader.u8Decimation = CAPTURE_DECIMATION;
+	s_sHeader.u8Trigger = s_eTrigger;
+#if DIRDETECT_SCAN_SKEW_FIX
+	s_sHeader.i16SkewAB = DIRDETECT_SKEW_AB;
+	s_sHeader.i16SkewAC = DIRDETECT_SKEW_AC;
+#endif
+	if (!micCalLoad(&s_sHeader.sCal))
+		micCalSetNeutral(&s_sHeader.sCal);
+}
+
+// Write the header, which always fits in a new file, then start the
+// decimator on a frame boundary.
+static void start_recording(void)
+{
+	s_sHeader.u8Engine = dirDetectGetEngine();
+	s_sHeader.u32Tick = osKernelSysTick();
+	spiFSStreamWrite(&s_sStream, (const UINT8 *) &s_sHeader, sizeof(s_sHeader));
+	memset(s_ai32Sum, 0, sizeof(s_ai32Sum));
+	s_u8Summed = 0;
+	s_u8Dropped = 0;
+	s_eState = eCAPTURE_RECORDING;
+}
+
+//
+// Global Functions
+//
+
+void captureInit(osThreadId tidService, INT32 i32Signals)
+{
+	spiMasterMutex = osMutexCreate(osMutex(spiMasterMutex));
+	s_i32ServiceSignals = i32Signals;
+	s_tidService = tidService;
+}
+
+void captureRequest(E_CAPTURE_TRIGGER eTrigger)
+{
+	s_eTrigger = eTrigger;
+	s_bStartRequested = TRUE;
+	signal_service();
+}
+
+void captureRequestStop(void)
+{
+	s_bStopRequested = TRUE;
+	signal_service();
+}
+
+E_CAPTURE_STATE captureGetState(void)
+{
+	return s_eState;
+}
+
+BOOL captureIsRecording(void)
+{
+	return (s_eState == eCAPTURE_RECORDING);
+}
+
+void captureService(void)
+{
+	// Stop what is under way.  The detector thread is above us, so once
+	// the state says so it won't touch the file again.
+	if (s_bStopRequested || (s_eState == eCAPTURE_CLOSING)) {
+		s_bStopRequested = FALSE;
+		if ((s_eState == eCAPTURE_ARMED) || (s_eState == eCAPTURE_RECORDING) || (s_eState == eCAPTURE_CLOSING)) {
+			s_eState = eCAPTURE_CLOSING;
+			spiFSStreamClose(&s_sStream);
+			s_eState = eCAPTURE_DONE;
+		}
+	}
+
+	// Start a new one unless one is open.
+	if (s_bStartRequested) {
+		s_bStartRequested = FALSE;
+		if ((s_eState == eCAPTURE_ARMED) || (s_eState == eCAPTURE_RECORDING))
+			return;
+		s_eState = eCAPTURE_OPENING;
+		fill_header();
+		if (!open_next_file()) {
+			s_eState = eCAPTURE_FAILED;
+			return;
+		}
+		s_eState = eCAPTURE_ARMED;
+
+		// A recording on command can't wait for a sound to wake the
+		// detector.
+		if (s_eTrigger == eCAPTURE_TRIGGER_COMMAND)
+			dirDetectWake();
+	}
+}
+
+BOOL capturePush(const INT16 * const *ppi16Ring, UINT32 u32From, UINT32 u32To, UINT32 u32Mask, BOOL bSound)
+{
+	S_CAPTURE_RECORD sRecord;
+	UINT32 u32Sample;
+	UINT8 u8Source;
+	UINT8 u8Mic;
+
+	if (s_eState == eCAPTURE_ARMED) {
+		if ((s_eTrigger == eCAPTURE_TRIGGER_ONSET) && !bSound)
+			return FALSE;
+		start_recording();
+	}
+	if (s_eState != eCAPTURE_RECORDING)
+		return FALSE;
+
+	// Start the next page programming if the flash is done with the last.
+	spiFSStreamPoll(&s_sStream);
+
+	// Close the file once a record might not fit in what is left of it.
+	if (spiFSStreamLeft(&s_sStream) < CAPTURE_MAX_RECORD) {
+		s_eState = eCAPTURE_CLOSING;
+		signal_service();
+		return TRUE;
+	}
+
+	sRecord.u32Sample = u32From - s_u8Summed;
+	sRecord.u8Frames = (UINT8) ((s_u8Summed + (u32To - u32From)) >> CAPTURE_DECIMATION_SHIFT);
+	sRecord.u8Dropped = s_u8Dropped;
+	for(u8Source = 0; u8Source<DIRDETECT_NUM_SOURCES; u8Source++)
+		sRecord.au8Track[u8Source] = (dirDetectGetConfidence(u8Source) << 4) | dirDetectGetDirection(u8Source);
+
+	// If the flash is behind, drop the record and start the next one on a
+	// frame boundary.
+	if (spiFSStreamSpace(&s_sStream) < sizeof(sRecord) + sRecord.u8Frames*CAPTURE_FRAME_SIZE) {
+		if (s_u8Dropped < 255)
+			s_u8Dropped++;
+		memset(s_ai32Sum, 0, sizeof(s_ai32Sum));
+		s_u8Summed = 0;
+		return TRUE;
+	}
+	spiFSStreamWrite(&s_sStream, (const UINT8 *) &sRecord, sizeof(sRecord));
+	s_u8Dropped = 0;
+
+	// Box filter each mic down to the recorded rate, a frame at a time.
+	for(u32Sample = u32From; u32Sample != u32To; u32Sample++) {
+		INT16 ai16Frame[NUM_CHANNELS];
+
+		for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++)
+			s_ai32Sum[u8Mic] += ppi16Ring[u8Mic][u32Sample & u32Mask];
+		if (++s_u8Summed < CAPTURE_DECIMATION)
+			continue;
+
+		for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++) {
+			ai16Frame[u8Mic] = (INT16) (s_ai32Sum[u8Mic] >> CAPTURE_DECIMATION_SHIFT);
+			s_ai32Sum[u8Mic] = 0;
+		}
+		s_u8Summed = 0;
+		spiFSStreamWrite(&s_sStream, (const UINT8 *) ai16Frame, sizeof(ai16Frame));
+	}
+	return TRUE;
+}
+
+// The flash's page programs are interrupt driven (see spiFSStreamPoll()).
+void SPI0_IRQHandler(void)
+{
+	SPIFlash_ISR_NBK();
+}
+
+#endif // DIRDETECT_CAPTURE
@@ -0,0 +1,115 @@
+#ifndef __CAPTURE_H
+#define __CAPTURE_H
+
+#include "Platform.h"
+#include "DirDetect.h"
+#include "MicCal.h"
+
+//
+// Global Defines and Declarations
+//
+
+// Field recorder.  Streams the three mics into a SpiFS file on the serial
+// flash along with what the tracker made of them, so what a unit heard in
+// the field can be played back through the detector offline.  What is
+// recorded is not the raw ADC samples: they are calibrated (see MicCal.h)
+// and averaged down by CAPTURE_DECIMATION first, so at the default of 2 a
+// replay has half the sample rate, and twice the lag step, that the
+// detector had.  The flash is on SPI0, which takes GPIOA pins 1 to 4 away
+// from LEDs 1 and 2 in these builds.  Needs DIRDETECT_RTX.
+#ifndef DIRDETECT_CAPTURE
+#define DIRDETECT_CAPTURE 0 // build the recorder (about 640 bytes of RAM, and the 768 byte unfiltered ring it shares with DIRDETECT_AUDIO_STREAM if DIRDETECT_PREFILTER is on)
+#endif
+#if DIRDETECT_CAPTURE && !DIRDETECT_RTX
+#error "DIRDETECT_CAPTURE needs DIRDETECT_RTX"
+#endif
+
+#ifndef CAPTURE_DECIMATION
+#define CAPTURE_DECIMATION 2 // samples averaged into each one recorded (1, 2 or 4); 1 keeps the whole band, and the lag resolution on replay, for short recordings, but at about 300KB/s the flash may drop records and CAPTURE_SECTORS last under 2s
+#endif
+#define CAPTURE_SECTORS				128		// flash sectors claimed for a recording, about 3s of it at CAPTURE_DECIMATION 2
+#define CAPTURE_FILES				8		// recordings kept, "capture0" to "capture7"; delete them to record more
+#define CAPTURE_MAGIC				0x31434444	// "DDC1", change when the format changes
+
+#if (CAPTURE_DECIMATION != 1) && (CAPTURE_DECIMATION != 2) && (CAPTURE_DECIMATION != 4)
+#error "CAPTURE_DECIMATION must be 1, 2 or 4"
+#endif
+
+typedef enum {
+	eCAPTURE_TRIGGER_ONSET,		// recording starts with the next sound the detector hears, and a little before it
+	eCAPTURE_TRIGGER_COMMAND	// recording starts as soon as the file is open
+} E_CAPTURE_TRIGGER;
+
+typedef enum {
+	eCAPTURE_IDLE,				// nothing asked for since boot
+	eCAPTURE_OPENING,			// claiming the flash for the file, a few seconds
+	eCAPTURE_ARMED,				// waiting for a sound
+	eCAPTURE_RECORDING,
+	eCAPTURE_CLOSING,			// the file is full or a stop was asked for
+	eCAPTURE_DONE,				// the last recording is in flash
+	eCAPTURE_FAILED				// all CAPTURE_FILES are there already or the flash is full
+} E_CAPTURE_STATE;
+
+// A recording is an S_CAPTURE_HEADER, then one S_CAPTURE_RECORD for each
+// hop the detector processed, each followed by u8Frames frames of three
+// INT16s (mics A, B and C), each the mean of u8Decimation samples.  The
+// samples have the mics' offsets and gains taken out (see sCal), but not
+// DIRDETECT_PREFILTER, which the detector applies again on replay, and
+// still have their delays and the scan skew.  Little endian, as the CPU
+// writes them.
+typedef __packed struct {
+	UINT32 u32Magic;			// CAPTURE_MAGIC
+	UINT32 u32SampleRate;		// frames per second (SAMPLE_FREQUENCY/CAPTURE_DECIMATION)
+	UINT32 u32ScanRate;			// ADC scans per second (ADC_SCAN_FREQUENCY)
+	UINT8 u8Channels;			// NUM_CHANNELS
+	UINT8 u8Decimation;			// CAPTURE_DECIMATION
+	UINT8 u8Trigger;			// E_CAPTURE_TRIGGER
+	UINT8 u8Engine;				// E_DIRDETECT_ENGINE making the decisions in the records
+	INT16 i16SkewAB;			// DIRDETECT_SKEW_AB and DIRDETECT_SKEW_AC, 1/DIRDETECT_LAG_ONE samples
+	INT16 i16SkewAC;
+	UINT32 u32Tick;				// osKernelSysTick() when recording started
+	S_MICCAL sCal;				// the calibration in data flash, a neutral one if there isn't one
+} S_CAPTURE_HEADER;
+
+typedef __packed struct {
+	UINT32 u32Sample;			// when the first frame's first sample was taken, in samples at SAMPLE_FREQUENCY; gaps mean dropped records
+	UINT8 u8Frames;
+	UINT8 u8Dropped;			// records dropped since the last one, as the flash fell behind (saturates)
+	UINT8 au8Track[DIRDETECT_NUM_SOURCES];	// the tracker's output after the hop, as I2C_REG_TRACK reads it
+} S_CAPTURE_RECORD;
+
+//
+// Global Functions
+//
+
+#if DIRDETECT_CAPTURE
+// Call once from the thread that will run captureService(), after
+// dirDetectInit().  That thread is sent i32Signals whenever there is
+// something for captureService() to do.
+void captureInit(osThreadId tidService, INT32 i32Signals);
+
+// For the I2C slave.  Start a recording into the next free file, or stop
+// the one under way.
+void captureRequest(E_CAPTURE_TRIGGER eTrigger);
+void captureRequestStop(void);
+E_CAPTURE_STATE captureGetState(void);
+
+// Open and close the files as asked.  Blocks on the flash for seconds at
+// a time, so it runs in a thread below the detector's.
+void captureService(void);
+
+// For the detector thread, each hop.  Record the samples u32From..u32To-1
+// of the capture rings (one per mic, indexed with u32Mask) if a recording is
+// under way or bSound starts an armed one.  Returns FALSE if it didn't
+// take them, so an armed recording can start with the ones before the
+// sound.
+BOOL capturePush(const INT16 * const *ppi16Ring, UINT32 u32From, UINT32 u32To, UINT32 u32Mask, BOOL bSound);
+
+// TRUE while samples are being recorded, so the detector doesn't go back
+// to sleep on the comparators.
+BOOL captureIsRecording(void);
+#else
+#define captureIsRecording()		FALSE
+#endif
+
+#endif // __CAPTURE_H
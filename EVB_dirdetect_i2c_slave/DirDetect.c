@@ -6,16 +6,23 @@
 #include "Driver/DrvADC.h"
 
 #include "DirDetect.h"
+#include "GccPhat.h"
+#include "DirTable.h"
+#include "MicCal.h"
+#include "VendorJudge.h"
+#include "Capture.h"
+#include "AudioStream.h"
+#include "Profile.h"
 #include "Debug.h"
+#if DIRDETECT_NUADCFILTER && (DIRDETECT_OVERSAMPLE > 1)
+#include "Audio/NuADCFilterEx.h"
+#endif
 
 //
 // Global Variables
 //
 INT32 direction = 0x02;
 
-// Direction detection thread ID.
-//osThreadId dirDetectThreadId;
-
 //
 // Local Variables and Defines
 //
@@ -24,56 +31,493 @@ INT32 direction = 0x02;
 
 #define PRINT_VALS 0
 
-INT16 ai16ADC_BUF_A[ADC_BUFFER_SIZE];
-INT16 ai16ADC_BUF_B[ADC_BUFFER_SIZE];
-INT16 ai16ADC_BUF_C[ADC_BUFFER_SIZE];
-
-static UINT16	s_u16Samples = 0;
-static unsigned short collect_samples;
-static INT16 maxOfA = 0;
+#if DIRDETECT_RTX
+// The direction processing thread.  ADC_IRQHandler signals it every hop.  It
+// runs above the other threads, and any interrupt can preempt it.
+#define DIRDETECT_THREAD_PRIORITY		osPriorityAboveNormal
+#define DIRDETECT_THREAD_STACK			512		// bytes, counted in OS_PRIVSTKSIZE (RTX_Conf_CM.c)
+static osThreadId s_tidDetector = NULL;
+static osThreadId s_tidListener = NULL;		// told about tracker changes, see dirDetectNotify()
+static INT32 s_i32ListenerSignals = 0;
+#else
+// The software interrupt that runs the direction processing.  The USB block
+// isn't used on this board, so its vector (USB_IRQHandler) is borrowed; the
+// NVIC lets us pend it from the ADC interrupt.  It runs at the lowest priority
+// so the I2C slave (GPAB) and the ADC can always preempt it.
+#define DIRDETECT_PROCESS_IRQn			USB_IRQn
+#define DIRDETECT_PROCESS_PRIORITY		3
+#endif
+
+// Continuous capture ring for each microphone.  The ADC interrupt never
+// stops writing; analysis windows are cut out of it after the fact.
+#define RING_MASK						(DIRDETECT_RING_SIZE - 1)
+static INT16 s_ai16RingA[DIRDETECT_RING_SIZE];
+static INT16 s_ai16RingB[DIRDETECT_RING_SIZE];
+static INT16 s_ai16RingC[DIRDETECT_RING_SIZE];
+static const INT16 * const s_api16Ring[NUM_CHANNELS] = { s_ai16RingA, s_ai16RingB, s_ai16RingC };
+
+// What the recorder and the streamer take, alongside the ring: the same
+// samples before DIRDETECT_PREFILTER, which shapes them for the lag search
+// rather than for listening to or replaying.
+#define TAP_RING						(DIRDETECT_PREFILTER && (DIRDETECT_CAPTURE || DIRDETECT_AUDIO_STREAM))
+#if TAP_RING
+static INT16 s_aai16Tap[NUM_CHANNELS][DIRDETECT_RING_SIZE];
+static const INT16 * const s_api16Tap[NUM_CHANNELS] = { s_aai16Tap[0], s_aai16Tap[1], s_aai16Tap[2] };
+#else
+#define s_api16Tap						s_api16Ring		// nothing to keep out of it
+#endif
+static volatile UINT32 s_u32Head = 0;		// total samples written (ring index is s_u32Head & RING_MASK)
+static UINT16 s_u16HopSamples = 0;			// samples since the processing interrupt was last pended
+
+// The analysis window, copied out of the ring so the estimators see
+// contiguous buffers.
+static INT16 ai16WindowA[ADC_BUFFER_SIZE];
+static INT16 ai16WindowB[ADC_BUFFER_SIZE];
+static INT16 ai16WindowC[ADC_BUFFER_SIZE];
+static INT16 * const pi16ADC_BUF_A = ai16WindowA;
+static INT16 * const pi16ADC_BUF_B = ai16WindowB;
+static INT16 * const pi16ADC_BUF_C = ai16WindowC;
+static INT16 * const s_api16Window[NUM_CHANNELS] = { ai16WindowA, ai16WindowB, ai16WindowC };
+
+static volatile BOOL s_bProcessing = FALSE;	// the processing thread or interrupt hasn't finished
+static UINT16 s_u16Overruns = 0;				// hops where processing was still busy
+static UINT32 s_u32Windows = 0;				// windows loud enough to run the estimator on
+static UINT32 s_u32Rejected = 0;			// ...and those of them the tracker never saw
+static INT16 s_ai16WindowPeak[NUM_CHANNELS];	// largest |sample| of each channel in the analysis window
+
+// Onset tracking, all in s_u32Head sample counts.
+static UINT32 s_u32Checked = 0;				// next sample to scan for an onset
+static BOOL s_bEventActive = FALSE;			// a sound is being followed
+static UINT32 s_u32WindowStart = 0;			// first sample of the next analysis window
+static INT32 s_ai32Floor[NUM_CHANNELS];	// noise floor of each channel, DIRDETECT_FLOOR_FRAC_BITS fractional bits
+static UINT32 s_u32ValidFrom = 0;			// oldest sample captured since the last wake up
+
+#if DIRDETECT_WAKE_ON_SOUND
+// Wake-on-sound.  While the room is quiet the per-sample interrupt is off
+// and only the two ADC result monitors run, each on its own mic: compare0
+// for mic A rising, compare1 for mic C falling.  Each monitor takes one
+// channel, and two on the same mic would leave a sound that reaches it
+// weakly (shadowed by the head, say) unheard for longer.  A sound swings
+// both ways, so one polarity a mic is enough.  CMPD is 12 bits in the same
+// two's complement format as the conversion result.
+#define WAKE_MICS						2
+#define WAKE_MIC_RISE					0	// mic A, in s_ai16WakePeak[0], on compare0...
+#define WAKE_CHANNEL_RISE				eDRVADC_CH0CH1
+#define WAKE_MIC_FALL					2	// ...and mic C, in s_ai16WakePeak[1], on compare1
+#define WAKE_CHANNEL_FALL				eDRVADC_CH4CH5
+#define WAKE_MATCH_COUNT				2	// consecutive matches needed, ignores single sample spikes
+static volatile BOOL s_bArmed = FALSE;		// waiting on the comparators
+static UINT16 s_u16QuietHops = 0;			// hops since the last sound while awake
+static volatile INT16 s_ai16WakePeak[WAKE_MICS];	// largest |conversion - the mic's offset| since the last hop
+static INT32 s_ai32WakeFloor[WAKE_MICS];	// their noise floors, as s_ai32Floor but in the comparators' terms
+#endif
+
+static E_DIRDETECT_ENGINE s_eEngine = DIRDETECT_ENGINE_DEFAULT;
+
+// Calibration in use, neutral until one is loaded or measured.
+static S_MICCAL s_sCal =
+{
+	0, 0, 0,
+	{ 0, 0, 0 },
+	{ MICCAL_GAIN_ONE, MICCAL_GAIN_ONE, MICCAL_GAIN_ONE },
+	0, 0,
+	0
+};
+static volatile E_DIRDETECT_CAL_STATE s_eCalState = eDIRDETECT_CAL_NONE;
+
+#if DIRDETECT_VENDOR
+static UINT32 s_u32VendorFed = 0;			// next sample to decimate for DirDetect_Judge()
+#endif
+#if DIRDETECT_CAPTURE
+static UINT32 s_u32CaptureFed = 0;			// next sample for the recorder
+#endif
+#if DIRDETECT_AUDIO_STREAM
+static UINT32 s_u32StreamFed = 0;			// next sample for the streamer
+#endif
+#if (DIRDETECT_OVERSAMPLE > 1)
+// Oversampling front end.  The ADC scans DIRDETECT_OVERSAMPLE times for each
+// sample the detector sees, and every channel is low-pass filtered down to
+// SAMPLE_FREQUENCY before anything else looks at it, so the noise above the
+// band the lags are measured in isn't folded back into it.
+static UINT8 s_u8Scans = 0;					// scans taken towards the next sample
+#if DIRDETECT_NUADCFILTER
+static UINT16 s_aau16FilterWork[NUM_CHANNELS][NUADCFILTEREX_DOWN4_WORK_BUF_SIZE/2];	// one filter per mic, UINT16 for the alignment it needs
+static INT16 s_aai16Scans[NUM_CHANNELS][DIRDETECT_OVERSAMPLE];	// the block of scans it takes
+#else
+// Second order CIC: two integrators at the scan rate, then two combs at the
+// sample rate.  The integrators are allowed to wrap, which the combs undo.
+// The gain is DIRDETECT_OVERSAMPLE squared.
+#define CIC_GAIN_SHIFT					((DIRDETECT_OVERSAMPLE == 4) ? 4 : 2)
+static UINT32 s_aau32Integrator[NUM_CHANNELS][2];
+static UINT32 s_aau32Comb[NUM_CHANNELS][2];	// each comb's input at the last sample
+#endif
+#endif
+#if DIRDETECT_PREFILTER
+// The band-pass is the RBJ cookbook one with 0dB at its centre:
+//
+//   y[n] = b0*(x[n] - x[n-2]) - a1*y[n-1] - a2*y[n-2]
+//
+// with b0 = alpha/(1 + alpha), a1 = -2*cos(w0)/(1 + alpha) and
+// a2 = (1 - alpha)/(1 + alpha), alpha = sin(w0)/(2*Q).  The coefficients
+// are Q14 constants the compiler works out from the band and
+// SAMPLE_FREQUENCY (the sine and cosine as Taylor series, which are exact
+// enough for w0 under a radian); nothing is computed at run time.
+#if (DIRDETECT_PREFILTER_BAND == DIRDETECT_BAND_SPEECH)
+#define PREFILTER_F0					1000	// Hz
+#define PREFILTER_Q100					35		// Q in hundredths
+#elif (DIRDETECT_PREFILTER_BAND == DIRDETECT_BAND_CLAP)
+#define PREFILTER_F0					2200
+#define PREFILTER_Q100					50
+#endif
+#ifdef PREFILTER_F0
+#define PREFILTER_SHIFT					14
+#define PREFILTER_W0					(2*3.14159265358979*PREFILTER_F0/SAMPLE_FREQUENCY)
+#define PREFILTER_W2					(PREFILTER_W0*PREFILTER_W0)
+#define PREFILTER_COS					(1 - PREFILTER_W2/2*(1 - PREFILTER_W2/12*(1 - PREFILTER_W2/30)))
+#define PREFILTER_SIN					(PREFILTER_W0*(1 - PREFILTER_W2/6*(1 - PREFILTER_W2/20*(1 - PREFILTER_W2/42))))
+#define PREFILTER_ALPHA					(PREFILTER_SIN*50/PREFILTER_Q100)
+#define PREFILTER_COEF(x)				((INT32) ((x)*(1 << PREFILTER_SHIFT)/(1 + PREFILTER_ALPHA) + 0.5))
+#define PREFILTER_B0					PREFILTER_COEF(PREFILTER_ALPHA)
+#define PREFILTER_A1					PREFILTER_COEF(2*PREFILTER_COS)		// negated
+#define PREFILTER_A2					PREFILTER_COEF(1 - PREFILTER_ALPHA)
+#endif
+typedef struct {
+	INT32 i32Dc;				// DC blocker output, 8 fractional bits
+	INT16 i16DcIn;				// its last input
+	INT16 ai16X[2];				// band-pass inputs n-1 and n-2
+	INT16 ai16Y[2];				// and outputs
+} S_PREFILTER;
+static S_PREFILTER s_asPrefilter[NUM_CHANNELS];
+#endif
+#if DIRDETECT_CLASSIFY
+// What classify_hop() follows on mic A.
+typedef struct {
+	UINT32 u32Short;			// energy envelopes, a hop's worth of squared samples/4
+	UINT32 u32Long;
+	UINT16 u16Crossings;		// zero crossings a hop, DIRDETECT_LAG_FRAC_BITS fractional bits
+	UINT16 u16SinceRise;		// hops since the last transient started (saturates)
+	UINT16 u16Steady;			// hops the short envelope has stayed near the long one (saturates)
+	INT16 i16Last;				// the last sample, for the next hop's first crossing
+} S_CLASSIFIER;
+
+#define CLASS_SPEECH_CROSSINGS	(((2*DIRDETECT_CLASS_SPEECH_HZ*DIRDETECT_HOP_SIZE) << DIRDETECT_LAG_FRAC_BITS)/SAMPLE_FREQUENCY)
+
+static S_CLASSIFIER s_sClassifier;
+static UINT8 s_u8ClassPolicy = DIRDETECT_CLASS_POLICY;
+static E_DIRDETECT_CLASS s_eClass = eDIRDETECT_CLASS_NOISE;	// of the last window
+static UINT32 s_au32ClassWindows[eDIRDETECT_CLASS_COUNT];
+#endif
+#if DIRDETECT_BENCHMARK
+static S_DIRDETECT_BENCH s_sBench;
+#endif
+static BOOL s_bCapturing = FALSE;			// start_ADC() has run
+
+// Direction tracker.  Every analysed window adds evidence to the sector it
+// points at, weighted by how much it can be trusted, and all of it decays
+// each hop.  Indexed by LED - 1.
+static UINT32 s_au32Evidence[DIRDETECT_NUM_SECTORS];
+static UINT8 s_au8Light[DIRDETECT_NUM_SOURCES];		// LED reported for each source, 0 for none
+static UINT8 s_au8Confidence[DIRDETECT_NUM_SOURCES];	// share of the evidence near each source, 0..15
+static INT32 s_ai32BearingX[DIRDETECT_NUM_SECTORS];	// the evidence's lags as a direction (see DIRTABLE_BEARING_X()), weighted the same
+static INT32 s_ai32BearingY[DIRDETECT_NUM_SECTORS];
+static UINT16 s_au16Bearing[DIRDETECT_NUM_SOURCES];	// bearing of each source's LED, tenths of a degree
 //
 // Local Functions
 //
 
-// Handle the direction detection ADC interrupt.
-void ADC_IRQHandler()
+// Level that starts a sound over the noise floor i32Floor.
+static INT32 floor_threshold(INT32 i32Floor)
 {
-	// Process the ADC direction detection interrupt.
-	if (collect_samples)
-	{
-		if (DrvADC_GetAdcIntFlag())
-		{
-			ai16ADC_BUF_A[s_u16Samples] = 	DrvADC_GetConversionDataSigned(0);
-			ai16ADC_BUF_B[s_u16Samples] = 	DrvADC_GetConversionDataSigned(1);
-			ai16ADC_BUF_C[s_u16Samples] = 	DrvADC_GetConversionDataSigned(2);
-			
-			s_u16Samples++;
-			
-				
-			if (maxOfA < ai16ADC_BUF_A[s_u16Samples])
-				maxOfA = ai16ADC_BUF_A[s_u16Samples];
+	INT32 i32Threshold = ((i32Floor >> DIRDETECT_FLOOR_FRAC_BITS)*DIRDETECT_ONSET_GAIN) >> 3;
+	
+	return (i32Threshold < DIRDETECT_ONSET_MIN) ? DIRDETECT_ONSET_MIN : i32Threshold;
+}
 
-			if (s_u16Samples >= (ADC_BUFFER_SIZE))
-			{	
-				s_u16Samples = 0;
-				collect_samples = 0;
-			}
-		}
+// Level on channel u8Mic that starts a sound.  This is the same test
+// Do_Loop() applies to a whole window, so it follows the noise floor.
+static INT32 onset_threshold(UINT8 u8Mic)
+{
+	return floor_threshold(s_ai32Floor[u8Mic]);
+}
+
+// Follow the noise floor *pi32Floor with i16Peak, the largest |sample| over
+// the last hop.  It rises slowly so a sound doesn't raise its own
+// threshold, and falls quickly once the sound is over.
+static void update_floor(INT32 *pi32Floor, INT16 i16Peak)
+{
+	INT32 i32Diff = ((INT32) i16Peak << DIRDETECT_FLOOR_FRAC_BITS) - *pi32Floor;
+	
+	if (i32Diff > 0)
+		*pi32Floor += i32Diff >> DIRDETECT_FLOOR_ATTACK_SHIFT;
+	else
+		*pi32Floor -= (-i32Diff) >> DIRDETECT_FLOOR_RELEASE_SHIFT;
+}
+
+#if (DIRDETECT_OVERSAMPLE > 1)
+static void decimate_reset(void)
+{
+	UINT8 u8Mic;
+	
+	s_u8Scans = 0;
+	for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++) {
+#if DIRDETECT_NUADCFILTER
+#if (DIRDETECT_OVERSAMPLE == 2)
+		NuADCFilterEx_Down2Initial((UINT8 *) s_aau16FilterWork[u8Mic]);
+#else
+		NuADCFilterEx_Down4Initial((UINT8 *) s_aau16FilterWork[u8Mic]);
+#endif
+#else
+		s_aau32Integrator[u8Mic][0] = s_aau32Integrator[u8Mic][1] = 0;
+		s_aau32Comb[u8Mic][0] = s_aau32Comb[u8Mic][1] = 0;
+#endif
+	}
+}
+
+// Add one scan to the decimators.  Every DIRDETECT_OVERSAMPLE'th scan this
+// returns TRUE with pi16Scan replaced by the filtered sample of each mic.
+static BOOL decimate_scan(INT16 *pi16Scan)
+{
+	UINT8 u8Mic;
+	
+#if DIRDETECT_NUADCFILTER
+	for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++)
+		s_aai16Scans[u8Mic][s_u8Scans] = pi16Scan[u8Mic];
+	if (++s_u8Scans < DIRDETECT_OVERSAMPLE)
+		return FALSE;
+	s_u8Scans = 0;
+	
+	for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++)
+#if (DIRDETECT_OVERSAMPLE == 2)
+		pi16Scan[u8Mic] = NuADCFilterEx_Down2Process((UINT8 *) s_aau16FilterWork[u8Mic], s_aai16Scans[u8Mic]);
+#else
+		pi16Scan[u8Mic] = NuADCFilterEx_Down4Process((UINT8 *) s_aau16FilterWork[u8Mic], s_aai16Scans[u8Mic]);
+#endif
+#else
+	for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++) {
+		s_aau32Integrator[u8Mic][0] += (UINT32) (INT32) pi16Scan[u8Mic];
+		s_aau32Integrator[u8Mic][1] += s_aau32Integrator[u8Mic][0];
+	}
+	if (++s_u8Scans < DIRDETECT_OVERSAMPLE)
+		return FALSE;
+	s_u8Scans = 0;
+	
+	for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++) {
+		UINT32 u32Comb = s_aau32Integrator[u8Mic][1] - s_aau32Comb[u8Mic][0];
+		INT32 i32Out = (INT32) (u32Comb - s_aau32Comb[u8Mic][1]);
+		
+		s_aau32Comb[u8Mic][0] = s_aau32Integrator[u8Mic][1];
+		s_aau32Comb[u8Mic][1] = u32Comb;
+		pi16Scan[u8Mic] = (INT16) ((i32Out + (1 << (CIC_GAIN_SHIFT - 1))) >> CIC_GAIN_SHIFT);
 	}
+#endif
+	return TRUE;
+}
+#endif
+
+static INT32 saturate16(INT32 i32X)
+{
+	if (i32X > 32767)
+		return 32767;
+	if (i32X < -32768)
+		return -32768;
+	return i32X;
+}
+
+#if DIRDETECT_WAKE_ON_SOUND
+// Stop the per-sample interrupt and let the comparators wake us.  They
+// trip at a fraction of the onset threshold so the capture is already
+// running by the time the sound is loud enough to be analysed.  The
+// comparators see the raw conversions, before the calibration and the
+// prefilter, so each threshold comes from its mic's s_ai32WakeFloor rather
+// than the onset floors, and is set off from that mic's offset.
+static void wake_on_sound_arm(void)
+{
+	INT32 i32High = s_sCal.ai16Offset[WAKE_MIC_RISE] + (floor_threshold(s_ai32WakeFloor[0]) >> DIRDETECT_WAKE_SHIFT);
+	INT32 i32Low = s_sCal.ai16Offset[WAKE_MIC_FALL] - (floor_threshold(s_ai32WakeFloor[1]) >> DIRDETECT_WAKE_SHIFT);
+	
+	// CMPD only has 12 bits.
+	if (i32High > 2047)
+		i32High = 2047;
+	if (i32Low < -2048)
+		i32Low = -2048;
+	
+	__disable_irq();
+	ADC.ADCR.ADIE = 0;
+	DrvADC_EnableCompare0(WAKE_CHANNEL_RISE, eDRVADC_GREATER_OR_EQUAL, (UINT16) i32High & 0x0FFF, WAKE_MATCH_COUNT);
+	DrvADC_EnableCompare1(WAKE_CHANNEL_FALL, eDRVADC_LESS_THAN, (UINT16) i32Low & 0x0FFF, WAKE_MATCH_COUNT);
+	DrvADC_EnableCompare0Int();
+	DrvADC_EnableCompare1Int();
 	DrvADC_ClearAdcIntFlag();
+	s_bArmed = TRUE;
+	__enable_irq();
+}
+
+// Keep the largest distance of each watched mic's conversions from its
+// offset, which is what the comparators test, for s_ai32WakeFloor.
+static void follow_wake_peak(INT16 i16Raw, UINT8 u8Mic, UINT8 u8Peak)
+{
+	INT32 i32X = (INT32) i16Raw - s_sCal.ai16Offset[u8Mic];
+	
+	if (i32X < 0)
+		i32X = -i32X;
+	if (i32X > s_ai16WakePeak[u8Peak])
+		s_ai16WakePeak[u8Peak] = (INT16) saturate16(i32X);
+}
+
+// A comparator tripped: go back to sampling every conversion.  The ring
+// holds nothing useful from before this point, and the tracker's evidence
+// stopped decaying while we slept, so it is dropped too.
+static void wake_on_sound_wake(void)
+{
+	DrvADC_DisableCompare0Int();
+	DrvADC_DisableCompare1Int();
+	DrvADC_DisableCompare0();
+	DrvADC_DisableCompare1();
+	
+	s_u32ValidFrom = s_u32Head;
+#if DIRDETECT_VENDOR
+	s_u32VendorFed = s_u32Head;
+	vendorJudgeReset();
+#endif
+#if (DIRDETECT_OVERSAMPLE > 1)
+	decimate_reset();
+#endif
+	memset(s_au32Evidence, 0, sizeof(s_au32Evidence));
+	memset(s_ai32BearingX, 0, sizeof(s_ai32BearingX));
+	memset(s_ai32BearingY, 0, sizeof(s_ai32BearingY));
+	s_u16QuietHops = 0;
+	s_bArmed = FALSE;
+	DrvADC_EnableAdcInt();
+}
+#endif
+
+#if DIRDETECT_MIC_CAL
+// Take out a mic's offset and match its gain to mic A.
+static INT16 calibrate_sample(UINT8 u8Mic, INT16 i16Raw)
+{
+	return (INT16) saturate16(((i16Raw - s_sCal.ai16Offset[u8Mic])*(INT32) s_sCal.au16Gain[u8Mic]) >> MICCAL_GAIN_SHIFT);
+}
+#endif
+
+#if DIRDETECT_PREFILTER
+static void prefilter_reset(void)
+{
+	memset(s_asPrefilter, 0, sizeof(s_asPrefilter));
+}
+
+// Run one sample of a mic through its DC blocker and band-pass.
+static INT16 prefilter_sample(UINT8 u8Mic, INT16 i16X)
+{
+	S_PREFILTER *psFilter = &s_asPrefilter[u8Mic];
+	INT32 i32Y;
+	
+	// y[n] = x[n] - x[n-1] + (1 - 1/2^DIRDETECT_DC_BLOCK_SHIFT)*y[n-1]
+	psFilter->i32Dc += ((INT32) i16X - psFilter->i16DcIn) << 8;
+	psFilter->i32Dc -= psFilter->i32Dc >> DIRDETECT_DC_BLOCK_SHIFT;
+	psFilter->i16DcIn = i16X;
+	i32Y = saturate16((psFilter->i32Dc + (1 << 7)) >> 8);
+	
+#ifdef PREFILTER_F0
+	i16X = (INT16) i32Y;
+	i32Y = PREFILTER_B0*((INT32) i16X - psFilter->ai16X[1])
+		 + PREFILTER_A1*psFilter->ai16Y[0] - PREFILTER_A2*psFilter->ai16Y[1];
+	i32Y = saturate16((i32Y + (1 << (PREFILTER_SHIFT - 1))) >> PREFILTER_SHIFT);
+	psFilter->ai16X[1] = psFilter->ai16X[0];
+	psFilter->ai16X[0] = i16X;
+	psFilter->ai16Y[1] = psFilter->ai16Y[0];
+	psFilter->ai16Y[0] = (INT16) i32Y;
+#endif
+	return (INT16) i32Y;
+}
+#endif
+
+// What goes into the ring for one sample of a mic, the one at s_u32Head.
+static INT16 condition_sample(UINT8 u8Mic, INT16 i16X)
+{
+#if DIRDETECT_MIC_CAL
+	i16X = calibrate_sample(u8Mic, i16X);
+#endif
+#if TAP_RING
+	s_aai16Tap[u8Mic][s_u32Head & RING_MASK] = i16X;
+#endif
+#if DIRDETECT_PREFILTER
+	i16X = prefilter_sample(u8Mic, i16X);
+#endif
+	return i16X;
+}
 
+// Put one sample of each mic into the rings.
+static void store_sample(const INT16 *pi16Sample)
+{
+	UINT32 u32Index = s_u32Head & RING_MASK;
 	
+	s_ai16RingA[u32Index] = condition_sample(0, pi16Sample[0]);
+	s_ai16RingB[u32Index] = condition_sample(1, pi16Sample[1]);
+	s_ai16RingC[u32Index] = condition_sample(2, pi16Sample[2]);
+	s_u32Head++;
 
+	// Let the processing interrupt look at every new hop.
+	if (++s_u16HopSamples >= DIRDETECT_HOP_SIZE)
+	{
+		s_u16HopSamples = 0;
+		
+		if (!s_bProcessing)
+		{
+			s_bProcessing = TRUE;
+#if DIRDETECT_RTX
+			osSignalSet(s_tidDetector, DIRDETECT_SIGNAL_PROCESS);
+#else
+			NVIC_SetPendingIRQ(DIRDETECT_PROCESS_IRQn);
+#endif
+		}
+		else
+		{
+			// Still busy with the last hop.  Nothing is lost, the
+			// next call picks up every sample still in the ring.
+			s_u16Overruns++;
+		}
+	}
+}
 
+// Handle the direction detection ADC interrupt.
+void ADC_IRQHandler()
+{
+	UINT32 u32Profile;
+	
+	PROFILE_START(u32Profile);
+	
+#if DIRDETECT_WAKE_ON_SOUND
+	if (s_bArmed)
+	{
+		if (DrvADC_GetCompare0IntFlag() || DrvADC_GetCompare1IntFlag())
+			wake_on_sound_wake();
+		DrvADC_ClearCompare0IntFlag();
+		DrvADC_ClearCompare1IntFlag();
+		DrvADC_ClearAdcIntFlag();
+		PROFILE_END(ePROFILE_ADC_IRQ, u32Profile);
+		return;
+	}
+#endif
 
-	// If the ADC buffers need processing, then signal the
-	// direction detection thread to process the buffers.
-//	if (!collect_samples)
-//	{
-//		// Signal the direction detection thread.
-//		// buffers that were just finished with.
-//		osSignalSet(dirDetectThreadId, DIRDETECT_SIGNAL_PROCESS);
-//	}
+	// Process the ADC direction detection interrupt.
+	if (DrvADC_GetAdcIntFlag())
+	{
+		INT16 ai16Scan[NUM_CHANNELS];
+		
+		ai16Scan[0] = DrvADC_GetConversionDataSigned(0);
+		ai16Scan[1] = DrvADC_GetConversionDataSigned(1);
+		ai16Scan[2] = DrvADC_GetConversionDataSigned(2);
+#if DIRDETECT_WAKE_ON_SOUND
+		follow_wake_peak(ai16Scan[WAKE_MIC_RISE], WAKE_MIC_RISE, 0);
+		follow_wake_peak(ai16Scan[WAKE_MIC_FALL], WAKE_MIC_FALL, 1);
+#endif
+#if (DIRDETECT_OVERSAMPLE > 1)
+		if (decimate_scan(ai16Scan))
+#endif
+			store_sample(ai16Scan);
+	}
+	DrvADC_ClearAdcIntFlag();
+	PROFILE_END(ePROFILE_ADC_IRQ, u32Profile);
 }
 
 
@@ -92,6 +536,22 @@ static void SkipAdcUnstableInput(UINT16 u16SkipCount)
 }
 
 
+// Find the ADC offset setting, or put back the one the factory calibration
+// found so a warm boot doesn't scan for it again.  Expects the ADC to be
+// converting.
+static void calibrate_adc_offset(void)
+{
+#if DIRDETECT_MIC_CAL
+	if (micCalLoad(&s_sCal)) {
+		ADC.PGCR.OS = s_sCal.u16AdcOffsetSetting;
+		g_i16AveCalibrationValue = s_sCal.i16AdcAverage;
+		s_eCalState = eDIRDETECT_CAL_LOADED;
+		return;
+	}
+#endif
+	DrvADC_AnalysisAdcCalibration();
+}
+
 //	Init ADC. Including:
 //  Preamps.   Offset.   Operation Mode.
 void init_ADC(void)
@@ -112,11 +572,12 @@ void init_ADC(void)
 	DrvADC_SetAdcOperationMode(eDRVADC_CONTINUOUS_SCAN);		    // ap must set to eDRVADC_CONTINUOUS_SCAN for calibration
 	DrvADC_SetConversionDataFormat(eDRVADC_2COMPLIMENT);		        // ap must set to DRVADC_2COMPLIMENT for calibration
 
+	// Mics A, B and C in that order, see DIRDETECT_SCAN_SLOT_A.
 	DrvADC_SetConversionSequence(eDRVADC_CH0CH1,eDRVADC_CH2CH3,eDRVADC_CH4CH5, eDRVADC_SCANEND,
 									eDRVADC_SCANEND,eDRVADC_SCANEND, eDRVADC_SCANEND,eDRVADC_SCANEND);	
 
 	DrvADC_StartConvert();
-	DrvADC_AnalysisAdcCalibration();
+	calibrate_adc_offset();
 	DrvAPU_CalibrateDacDcWithAdcDc();
 	DrvADC_StopConvert();
 }
@@ -127,11 +588,40 @@ void init_ADC(void)
 void start_ADC(void)
 {
 	 DrvADC_StartConvert();				// start convert
-	 SkipAdcUnstableInput(128);			// skip 128 * 8 samples
+	 SkipAdcUnstableInput(128*DIRDETECT_OVERSAMPLE);	// skip 128 * 8 samples
+	 s_u32Head = 0;
+	 s_u16HopSamples = 0;
+	 s_u32Checked = 0;
+	 s_u32ValidFrom = 0;
+	 memset(s_ai32Floor, 0, sizeof(s_ai32Floor));
+#if DIRDETECT_WAKE_ON_SOUND
+	 memset(s_ai32WakeFloor, 0, sizeof(s_ai32WakeFloor));
+	 memset((void *) s_ai16WakePeak, 0, sizeof(s_ai16WakePeak));
+#endif
+	 s_bEventActive = FALSE;
+	 s_bProcessing = FALSE;
+	 s_bCapturing = TRUE;
+#if DIRDETECT_VENDOR
+	 s_u32VendorFed = 0;
+	 vendorJudgeReset();
+#endif
+#if (DIRDETECT_OVERSAMPLE > 1)
+	 decimate_reset();
+#endif
+#if DIRDETECT_PREFILTER
+	 prefilter_reset();
+#endif
+#if DIRDETECT_CLASSIFY
+	 memset(&s_sClassifier, 0, sizeof(s_sClassifier));
+#endif
+
+#if DIRDETECT_WAKE_ON_SOUND
+	 // Start listening on the comparators.
+	 NVIC_EnableIRQ(ADC_IRQn);
+	 wake_on_sound_arm();
+#else
 	 DrvADC_EnableAdcInt();				//enable ADC interrupt
-
-	 s_u16Samples = 0;
-	 collect_samples = 1;
+#endif
 }
 
 
@@ -283,248 +773,2030 @@ void TurnOff_Light(INT32 i32i)
 
 
 
-short find_phase_AB(void)
+// Sum-of-squared-difference cost for every lag of each microphone pair,
+// indexed by (lag + DIRDETECT_MAX_LAG).
+static INT32 ai32CostAB[DIRDETECT_NUM_LAGS];
+static INT32 ai32CostAC[DIRDETECT_NUM_LAGS];
+static INT32 ai32CostBC[DIRDETECT_NUM_LAGS];
+
+// Running sums of squared samples.  au32EnergyA[k] holds the energy of
+// pi16ADC_BUF_A[0..k-1], so the energy of any window is one subtraction.
+static UINT32 au32EnergyA[ADC_BUFFER_SIZE + 1];
+static UINT32 au32EnergyB[ADC_BUFFER_SIZE + 1];
+static UINT32 au32EnergyC[ADC_BUFFER_SIZE + 1];
+
+#if DIRDETECT_COARSE_STEP > 1
+// One microphone pair of the SSD search: pi16X is shifted by the lag
+// against pi16Y.
+typedef struct {
+	const INT16 *pi16X;
+	const UINT32 *pu32EnergyX;
+	const INT16 *pi16Y;
+	const UINT32 *pu32EnergyY;
+	INT32 *pi32Cost;
+} S_DIRDETECT_PAIR;
+
+static const S_DIRDETECT_PAIR s_asPair[3] =
+{
+	{ ai16WindowA, au32EnergyA, ai16WindowB, au32EnergyB, ai32CostAB },
+	{ ai16WindowA, au32EnergyA, ai16WindowC, au32EnergyC, ai32CostAC },
+	{ ai16WindowB, au32EnergyB, ai16WindowC, au32EnergyC, ai32CostBC },
+};
+
+// Which lags of each pair hold a real cost, bit n for s_asPair[n].
+static UINT8 s_au8Evaluated[DIRDETECT_NUM_LAGS];
+#endif
+static UINT32 s_u32CostLags = 0;			// pair-lags the SSD search has evaluated
+
+#if DIRDETECT_COARSE_CHECK
+static INT32 ai32CheckAB[DIRDETECT_NUM_LAGS];
+static INT32 ai32CheckAC[DIRDETECT_NUM_LAGS];
+static INT32 ai32CheckBC[DIRDETECT_NUM_LAGS];
+static UINT32 s_u32CoarseMisses = 0;		// windows where the search missed the exhaustive best lag
+#endif
+
+// Running sums of the squared samples of each window.
+static void compute_energies(void)
 {
-	int phase,i;
-	int sub = 0, cost = 0;
-	int best_phase = 0, bestcost = 0x7FFFFFFF;
+	int i;
 	
-	for(phase = -PHASE_ESTIMATION_RESOLUTION; phase<PHASE_ESTIMATION_RESOLUTION; phase++) {
-		cost = 0;
-		for(i = PHASE_ESTIMATION_RESOLUTION; i<(ADC_BUFFER_SIZE - PHASE_ESTIMATION_RESOLUTION); i++) {
-			sub = ai16ADC_BUF_A[i + phase] - ai16ADC_BUF_B[i];
-			cost = cost + sub*sub;
-		}
-		if (bestcost > cost) {
-			bestcost = cost;
-			best_phase = phase;
-		}
+	au32EnergyA[0] = 0;
+	au32EnergyB[0] = 0;
+	au32EnergyC[0] = 0;
+	for(i = 0; i<ADC_BUFFER_SIZE; i++) {
+		au32EnergyA[i + 1] = au32EnergyA[i] + pi16ADC_BUF_A[i]*pi16ADC_BUF_A[i];
+		au32EnergyB[i + 1] = au32EnergyB[i] + pi16ADC_BUF_B[i]*pi16ADC_BUF_B[i];
+		au32EnergyC[i + 1] = au32EnergyC[i] + pi16ADC_BUF_C[i]*pi16ADC_BUF_C[i];
 	}
-	return best_phase;
 }
 
-short find_phase_AC(void)
+// The cost of one lag for all three microphone pairs in one pass over the
+// ADC buffers.  For each pair
+//
+//   cost(lag) = sum((X[i+lag] - Y[i])^2)
+//             = energyX(lag) + energyY - 2 * sum(X[i+lag] * Y[i])
+//
+// where the energy terms come from the running sums, so each lag only costs
+// one multiply-accumulate per pair.  The sums are UINT32, so a window loud
+// enough to overflow them wraps mod 2^32 instead of being undefined; where
+// nothing overflows, the cost is the brute-force search's exactly.
+static void cost_all_pairs(int lag, INT32 *pi32CostAB, INT32 *pi32CostAC, INT32 *pi32CostBC)
 {
-	int phase,i;
-	int sub = 0, cost = 0;
-	int best_phase = 0, bestcost = 0x7FFFFFFF;
+	const INT16 *pi16A = &pi16ADC_BUF_A[DIRDETECT_MAX_LAG + lag];
+	const INT16 *pi16B = &pi16ADC_BUF_B[DIRDETECT_MAX_LAG + lag];
+	UINT32 crossAB = 0, crossAC = 0, crossBC = 0;
+	UINT32 u32EnergyALag = au32EnergyA[ADC_BUFFER_SIZE - DIRDETECT_MAX_LAG + lag] - au32EnergyA[DIRDETECT_MAX_LAG + lag];
+	int i;
 	
-	for(phase = -P_E_RES; phase<P_E_RES; phase++) {
-		cost = 0;
-		for(i = P_E_RES; i<ADC_BUFFER_SIZE - P_E_RES; i++) {
-			sub = ai16ADC_BUF_A[i + phase] - ai16ADC_BUF_C[i];
-			cost = cost + sub*sub;
-		}
-		if (bestcost > cost) {
-			bestcost = cost;
-			best_phase = phase;
-		}
+	for(i = DIRDETECT_MAX_LAG; i<(ADC_BUFFER_SIZE - DIRDETECT_MAX_LAG); i++) {
+		INT32 a = *pi16A++;
+		INT32 bLag = *pi16B++;
+		INT32 b = pi16ADC_BUF_B[i];
+		INT32 c = pi16ADC_BUF_C[i];
+		
+		crossAB += a*b;
+		crossAC += a*c;
+		crossBC += bLag*c;
 	}
-	return best_phase;
+	
+	// The unshifted window is the same for every lag.
+	pi32CostAB[lag + DIRDETECT_MAX_LAG] = (INT32) (u32EnergyALag
+										+ (au32EnergyB[ADC_BUFFER_SIZE - DIRDETECT_MAX_LAG] - au32EnergyB[DIRDETECT_MAX_LAG]) - (crossAB << 1));
+	pi32CostAC[lag + DIRDETECT_MAX_LAG] = (INT32) (u32EnergyALag
+										+ (au32EnergyC[ADC_BUFFER_SIZE - DIRDETECT_MAX_LAG] - au32EnergyC[DIRDETECT_MAX_LAG]) - (crossAC << 1));
+	pi32CostBC[lag + DIRDETECT_MAX_LAG] = (INT32) ((au32EnergyB[ADC_BUFFER_SIZE - DIRDETECT_MAX_LAG + lag] - au32EnergyB[DIRDETECT_MAX_LAG + lag])
+										+ (au32EnergyC[ADC_BUFFER_SIZE - DIRDETECT_MAX_LAG] - au32EnergyC[DIRDETECT_MAX_LAG]) - (crossBC << 1));
 }
 
+#if (DIRDETECT_COARSE_STEP == 1) || DIRDETECT_COARSE_CHECK
+// The same for every lag.
+static void cost_all_lags(INT32 *pi32CostAB, INT32 *pi32CostAC, INT32 *pi32CostBC)
+{
+	int lag;
+	
+	for(lag = -DIRDETECT_MAX_LAG; lag<=DIRDETECT_MAX_LAG; lag++)
+		cost_all_pairs(lag, pi32CostAB, pi32CostAC, pi32CostBC);
+}
+#endif
 
-short find_phase_BC(void)
+#if DIRDETECT_COARSE_STEP > 1
+// The same for a single pair, for the refinement.
+static void cost_pair(UINT8 u8Pair, int k)
 {
-	int phase,i;
-	int sub = 0, cost = 0;
-	int best_phase = 0, bestcost = 0x7FFFFFFF;
+	const S_DIRDETECT_PAIR *psPair = &s_asPair[u8Pair];
+	const INT16 *pi16X = &psPair->pi16X[k];
+	const INT16 *pi16Y = &psPair->pi16Y[DIRDETECT_MAX_LAG];
+	UINT32 cross = 0;
+	int i;
 	
-	for(phase = -P_E_RES; phase<P_E_RES; phase++) {
-		cost = 0;
-		for(i = P_E_RES; i<ADC_BUFFER_SIZE - P_E_RES; i++) {
-			sub = ai16ADC_BUF_B[i + phase] - ai16ADC_BUF_C[i];
-			cost = cost + sub*sub;
-		}
-		if (bestcost > cost) {
-			bestcost = cost;
-			best_phase = phase;
-		}
-	}
+	for(i = DIRDETECT_MAX_LAG; i<(ADC_BUFFER_SIZE - DIRDETECT_MAX_LAG); i++)
+		cross += *pi16X++ * *pi16Y++;
+	
+	psPair->pi32Cost[k] = (INT32) ((psPair->pu32EnergyX[ADC_BUFFER_SIZE - 2*DIRDETECT_MAX_LAG + k] - psPair->pu32EnergyX[k])
+						+ (psPair->pu32EnergyY[ADC_BUFFER_SIZE - DIRDETECT_MAX_LAG] - psPair->pu32EnergyY[DIRDETECT_MAX_LAG]) - (cross << 1));
+	s_au8Evaluated[k] |= 1 << u8Pair;
+	s_u32CostLags++;
+}
 
-	return best_phase; 
+// Give every lag of a pair that hasn't been evaluated the higher of its
+// nearest evaluated neighbours.  The curve then has no minima but real
+// ones and keeps its real maximum, which is all the code that reads it
+// needs, and the neighbours of the best lag are always real.
+static void fill_gaps(UINT8 u8Pair)
+{
+	INT32 *pi32Cost = s_asPair[u8Pair].pi32Cost;
+	UINT8 u8Bit = 1 << u8Pair;
+	int left = 0, right, k;
+	
+	// Lag 0 and the last lag are on the coarse grid.
+	for(right = 1; right<DIRDETECT_NUM_LAGS; right++) {
+		if (!(s_au8Evaluated[right] & u8Bit))
+			continue;
+		for(k = left + 1; k<right; k++)
+			pi32Cost[k] = (pi32Cost[left] > pi32Cost[right]) ? pi32Cost[left] : pi32Cost[right];
+		left = right;
+	}
 }
 
+// Evaluate lag k of a pair if it is in range and hasn't been yet.  Returns
+// FALSE if it is out of range.
+static BOOL try_lag(UINT8 u8Pair, int k)
+{
+	if ((k < 0) || (k >= DIRDETECT_NUM_LAGS))
+		return FALSE;
+	if (!(s_au8Evaluated[k] & (1 << u8Pair)))
+		cost_pair(u8Pair, k);
+	return TRUE;
+}
 
+// Walk down the valley around the coarse minimum at lag k, halving the
+// step each time, and then on to a lag whose neighbours are both evaluated
+// and no lower.  Takes about 2*log2(DIRDETECT_COARSE_STEP) + 2 lags.
+static void refine_around(UINT8 u8Pair, int k)
+{
+	const INT32 *pi32Cost = s_asPair[u8Pair].pi32Cost;
+	int step = DIRDETECT_COARSE_STEP;
+	BOOL bMoved;
+	
+	do {
+		if (step > 1)
+			step >>= 1;
+		bMoved = FALSE;
+		if (try_lag(u8Pair, k - step) && (pi32Cost[k - step] <= pi32Cost[k])) {
+			k -= step;
+			bMoved = TRUE;
+		}
+		else if (try_lag(u8Pair, k + step) && (pi32Cost[k + step] < pi32Cost[k])) {
+			k += step;
+			bMoved = TRUE;
+		}
+	} while ((step > 1) || bMoved);
+	
+	// Make sure the final neighbours are real for the sub-sample fit.
+	try_lag(u8Pair, k - 1);
+	try_lag(u8Pair, k + 1);
+}
+#endif
 
+static int find_best_index(const INT32 *pi32Cost);
+static int find_second_index(const INT32 *pi32Cost, int best);
+static UINT8 minimum_depth(const INT32 *pi32Cost, int k, int best);
 
-void determineDirection(short phaseAB, short phaseAC, short phaseBC)
+#if DIRDETECT_COARSE_STEP > 1
+// The energies, and the costs of all three pairs at every
+// DIRDETECT_COARSE_STEP-th lag and the last one, the gaps filled in.
+static void coarse_cost_curves(void)
 {
-	static INT32 light, prev_light = 0;
-	static short consistency_counter = 1;
-	short size = 10;
+	UINT8 u8Pair;
+	int lag;
 	
-	prev_light = light;
-
-	if ((phaseAB <= size) && (phaseAB >= -size)) {
-		if ((phaseAC > 0) && (phaseBC > 0))
-			light = 2;
-		else
-			light = 8;
+	compute_energies();
+	memset(s_au8Evaluated, 0, sizeof(s_au8Evaluated));
+	for(lag = -DIRDETECT_MAX_LAG; lag<=DIRDETECT_MAX_LAG; lag += DIRDETECT_COARSE_STEP) {
+		cost_all_pairs(lag, ai32CostAB, ai32CostAC, ai32CostBC);
+		s_au8Evaluated[lag + DIRDETECT_MAX_LAG] = 0x07;
+		s_u32CostLags += 3;
 	}
-	else if ((phaseAC <= size) && (phaseAC >= -size)) {
-		if ((phaseAB > 0) && (phaseBC < 0))
-			light = 10;
-		else
-			light = 4;
+	if (!s_au8Evaluated[DIRDETECT_NUM_LAGS - 1]) {
+		cost_all_pairs(DIRDETECT_MAX_LAG, ai32CostAB, ai32CostAC, ai32CostBC);
+		s_au8Evaluated[DIRDETECT_NUM_LAGS - 1] = 0x07;
+		s_u32CostLags += 3;
 	}
-	else if ((phaseBC <= size) && (phaseBC >= -size)) {
-		if ((phaseAC < 0) && (phaseAB < 0))
-			light = 6;
-		else
-			light = 12;
+	for(u8Pair = 0; u8Pair<3; u8Pair++)
+		fill_gaps(u8Pair);
+}
+#endif
+
+// Compute the cost curves of all three microphone pairs.  With
+// DIRDETECT_COARSE_STEP above one only every DIRDETECT_COARSE_STEP-th lag
+// is tried at first; then refine_around() walks down to the bottom of the
+// best valley, and of the second best if it is deep enough to be a second
+// source.  The step grows with P_E_RES, as the valleys get wider in samples
+// with the sample rate, so the coarse pass stays at about six lags and
+// only the walk, which is logarithmic in the step, grows.
+static void compute_cost_curves(void)
+{
+#if DIRDETECT_COARSE_STEP > 1
+	UINT8 u8Pair;
+	int best, second;
+	
+	coarse_cost_curves();
+	for(u8Pair = 0; u8Pair<3; u8Pair++) {
+		INT32 *pi32Cost = s_asPair[u8Pair].pi32Cost;
+		
+		best = find_best_index(pi32Cost);
+		second = find_second_index(pi32Cost, best);
+		refine_around(u8Pair, best);
+		if ((second >= 0) && (minimum_depth(pi32Cost, second, best) >= DIRDETECT_SECOND_MIN_DEPTH))
+			refine_around(u8Pair, second);
+		fill_gaps(u8Pair);
 	}
-	else if ((phaseAB < 0) && (phaseAC < 0)) {  // sound hits A first
-		if (phaseBC > 0)
-			light = 5;
-		else
-			light = 7;
+#else
+	compute_energies();
+	cost_all_lags(ai32CostAB, ai32CostAC, ai32CostBC);
+	s_u32CostLags += 3*DIRDETECT_NUM_LAGS;
+#endif
+
+#if DIRDETECT_COARSE_CHECK
+	// Best lags only; the second source can differ.
+	cost_all_lags(ai32CheckAB, ai32CheckAC, ai32CheckBC);
+	if ((find_best_index(ai32CheckAB) != find_best_index(ai32CostAB)) ||
+		(find_best_index(ai32CheckAC) != find_best_index(ai32CostAC)) ||
+		(find_best_index(ai32CheckBC) != find_best_index(ai32CostBC)))
+		s_u32CoarseMisses++;
+#endif
+}
+
+// Return the index of the lowest cost.  Ties go to the most negative lag.
+static int find_best_index(const INT32 *pi32Cost)
+{
+	int k;
+	int best_index = 0, bestcost = 0x7FFFFFFF;
+	
+	for(k = 0; k<DIRDETECT_NUM_LAGS; k++) {
+		if (bestcost > pi32Cost[k]) {
+			bestcost = pi32Cost[k];
+			best_index = k;
+		}
 	}
-	else if ((phaseAC > 0) && (phaseBC > 0)) {  // sound hits C first
-		if (phaseAB > 0)
-			light = 1;
-		else
-			light = 3;
+	return best_index;
+}
+
+#if DIRDETECT_SUBSAMPLE
+// Fit a parabola through the minimum and its two neighbours and return the
+// offset of its vertex in 1/DIRDETECT_LAG_ONE samples:
+//
+//   offset = (left - right) / (2 * (left - 2*center + right))
+//
+// Because center is the minimum the offset is within +/- half a sample, so
+// the quotient is found with DIRDETECT_LAG_FRAC_BITS shift-and-subtract
+// steps instead of a library division (the M0 has no divide instruction).
+static int parabolic_offset(INT32 left, INT32 center, INT32 right)
+{
+	UINT32 num, den;
+	int bit, offset = 0;
+	BOOL negative = FALSE;
+	
+	// Work in unsigned so the differences of large costs don't overflow.
+	den = ((UINT32) left - (UINT32) center) + ((UINT32) right - (UINT32) center);
+	if (left >= right)
+		num = (UINT32) left - (UINT32) right;
+	else {
+		num = (UINT32) right - (UINT32) left;
+		negative = TRUE;
 	}
-	else if ((phaseAB > 0) && (phaseBC < 0)) {  // sound hits B first
-		if (phaseAC > 0)
-			light = 11;
-		else
-			light = 9;
+	if (den == 0)
+		return 0;
+	
+	// Scale down so the shifts below can't overflow.
+	while (den & 0xF0000000) {
+		den >>= 1;
+		num >>= 1;
 	}
-	else {
-		TurnOff_All();
-		consistency_counter = 1;
-		return;
+	
+	// Long division of num by 2*den, one bit beyond DIRDETECT_LAG_FRAC_BITS
+	// for rounding.
+	den <<= 1;
+	for(bit = 0; bit <= DIRDETECT_LAG_FRAC_BITS + 1; bit++) {
+		offset <<= 1;
+		if (num >= den) {
+			num -= den;
+			offset |= 1;
+		}
+		num <<= 1;
 	}
+	offset = (offset + 1) >> 1;
 	
-	// only turn on light if we are very confident in that direction
-	if (light == prev_light)
-		consistency_counter++;
-	else
-		consistency_counter = 1;
+	return negative ? -offset : offset;
+}
+#endif
+
+// Return u32Num/u32Den with u32Bits fractional bits, for u32Num <= u32Den
+// (the result saturates at all ones).  Shift-and-subtract, as in
+// parabolic_offset().
+static UINT32 fraction(UINT32 u32Num, UINT32 u32Den, UINT32 u32Bits)
+{
+	UINT32 u32Quotient = 0;
+	
+	if (u32Den == 0)
+		return 0;
+	
+	// Scale down so the remainder can be doubled without overflowing.
+	while (u32Den & 0xC0000000) {
+		u32Den >>= 1;
+		u32Num >>= 1;
+	}
 	
-	if (consistency_counter >=2) {
-		consistency_counter = 1;
-		TurnOff_All();
-		TurnOn_Light(light);
+	while (u32Bits--) {
+		u32Quotient <<= 1;
+		u32Num <<= 1;
+		if (u32Num >= u32Den) {
+			u32Num -= u32Den;
+			u32Quotient |= 1;
+		}
 	}
+	return u32Quotient;
 }
 
-int compute_average_sound_level(int currentSoundLevel) {
-	static int average_sound_level = 0;
-	static int count;
+// How clearly the minimum at pi32Cost[k] of a curve of n costs stands
+// out, 0..15: its distance from the worst cost against their size.  An SSD
+// curve from two copies of the same sound drops to almost nothing at the
+// right lag, and a GCC-PHAT one has a deep negative peak; noise leaves both
+// curves flat.
+static UINT8 minimum_sharpness(const INT32 *pi32Cost, int n, int k)
+{
+	INT32 i32Min = pi32Cost[k], i32Max = pi32Cost[0];
+	UINT32 u32Size;
+	int i;
 	
-	// IIR filter
-	if (count >=10) {
-		average_sound_level = average_sound_level*99 + currentSoundLevel*1;
-		average_sound_level /= 100; 
-		count = 0;
+	for(i = 1; i<n; i++) {
+		if (i32Max < pi32Cost[i])
+			i32Max = pi32Cost[i];
 	}
-	count++;
-//	average_sound_level = currentSoundLevel;
 	
-	// bump it up a bit so only louder sounds are heard
-	//average_sound_level *= 1.2;
-	return average_sound_level;
+	// (max - min)/(|max| + |min|), which is never more than one.
+	u32Size = ((i32Max < 0) ? -(UINT32) i32Max : (UINT32) i32Max)
+			+ ((i32Min < 0) ? -(UINT32) i32Min : (UINT32) i32Min);
+	return (UINT8) fraction((UINT32) i32Max - (UINT32) i32Min, u32Size, 4);
 }
 
-void Do_Loop(void)
+// How deep the minimum at pi32Cost[k] is against the best one at
+// pi32Cost[best], both measured down from the worst cost, 0..15 (15 for the
+// best one itself).
+static UINT8 minimum_depth(const INT32 *pi32Cost, int k, int best)
 {
-	static int phaseAB, phaseAC, phaseBC;
-	uint32_t multiplier = 10;
-	static int avgSoundLevel;
+	INT32 i32Max = pi32Cost[0];
+	int i;
 	
-//	int k;
+	if (k == best)
+		return 15;
+	for(i = 1; i<DIRDETECT_NUM_LAGS; i++) {
+		if (i32Max < pi32Cost[i])
+			i32Max = pi32Cost[i];
+	}
+	return (UINT8) fraction((UINT32) i32Max - (UINT32) pi32Cost[k], (UINT32) i32Max - (UINT32) pi32Cost[best], 4);
+}
 
-	if (!collect_samples) { //if we have collected an array's worth of data (and therefore not currently collecting samples), then do this interpretation.
-		
-//		avgSoundLevel = 1;
-		avgSoundLevel = compute_average_sound_level(maxOfA*10);
-//		avgSoundLevel = avgSoundLevel*9 + maxOfA*10;
-//		avgSoundLevel /= 10; 
-		
-		// ignore sounds that are too soft and just start sampling again
-		if((maxOfA*10 < avgSoundLevel*1.2) || (maxOfA < 40)) {
-			maxOfA = 0;
-			collect_samples = 1;
-			return;
-		}
+// How deep the lowest cost at least DIRDETECT_SOURCE_SEPARATION lags from
+// the best one at pi32Cost[best] is against it, both measured down from
+// the worst cost, 0..15: the peak-to-sidelobe ratio turned upside down.
+// Unlike find_second_index() any lag counts, minimum or not, so a curve
+// that is still falling at its end is as ambiguous as one with two valleys.
+static UINT8 sidelobe_level(const INT32 *pi32Cost, int best)
+{
+	INT32 i32Max = pi32Cost[0], i32Side = 0x7FFFFFFF;
+	int k;
+	
+	for(k = 0; k<DIRDETECT_NUM_LAGS; k++) {
+		if (i32Max < pi32Cost[k])
+			i32Max = pi32Cost[k];
+		if ((k > best - DIRDETECT_SOURCE_SEPARATION) && (k < best + DIRDETECT_SOURCE_SEPARATION))
+			continue;
+		if (i32Side > pi32Cost[k])
+			i32Side = pi32Cost[k];
+	}
+	return (UINT8) fraction((UINT32) i32Max - (UINT32) i32Side, (UINT32) i32Max - (UINT32) pi32Cost[best], 4);
+}
 
-	 
-		// estimate phase
-//		phaseAB = find_phase_AB()*multiplier*2;
-//		phaseAC = find_phase_AC()*multiplier;
-//		phaseBC = find_phase_BC()*multiplier;
-		
-		phaseAB = phaseAB*8 + find_phase_AB()*2*multiplier;
-		phaseAC = phaseAC*8 + find_phase_AC()*2*multiplier;
-		phaseBC = phaseBC*8 + find_phase_BC()*2*multiplier;
-
-		phaseAB /= 10;
-		phaseAC /= 10;
-		phaseBC /= 10;
-		// start adc conversions again
-		
-		collect_samples = 1; // let the ADC_ISR take data again
-		
-		
-		
-		// determine direction
-		determineDirection(phaseAB, phaseAC, phaseBC);
-		maxOfA = 0;
+// Return the index of the lowest local minimum at least
+// DIRDETECT_SOURCE_SEPARATION lags from the best one, or -1 if there isn't
+// one.  Only minima inside the curve count; at the ends it may still be
+// falling.
+static int find_second_index(const INT32 *pi32Cost, int best)
+{
+	int k;
+	int second_index = -1;
+	
+	for(k = 1; k<DIRDETECT_NUM_LAGS - 1; k++) {
+		if ((k > best - DIRDETECT_SOURCE_SEPARATION) && (k < best + DIRDETECT_SOURCE_SEPARATION))
+			continue;
+		if ((pi32Cost[k] < pi32Cost[k - 1]) && (pi32Cost[k] <= pi32Cost[k + 1]) &&
+			((second_index < 0) || (pi32Cost[second_index] > pi32Cost[k])))
+			second_index = k;
 	}
+	return second_index;
 }
 
-// Process the direction detection buffers.
-//static void dirDetectProcessBuffers(void)
-//{
-//	// turn off ADC interrupt
-//	collect_samples = 0;
-//	
-//	// XXX Process the direction detection buffers here.
-//	Do_Loop();
-//}
+// Return the lag of the minimum at pi32Cost[k] in 1/DIRDETECT_LAG_ONE samples.
+static short refine_lag(const INT32 *pi32Cost, int k)
+{
+	int lag = (k - DIRDETECT_MAX_LAG) << DIRDETECT_LAG_FRAC_BITS;
+	
+#if DIRDETECT_SUBSAMPLE
+	// Refine between the neighbours (not possible at the ends of the range).
+	if ((k > 0) && (k < DIRDETECT_NUM_LAGS - 1))
+		lag += parabolic_offset(pi32Cost[k - 1], pi32Cost[k], pi32Cost[k + 1]);
+#endif
+	return lag;
+}
+
+// Return the lag with the lowest cost in 1/DIRDETECT_LAG_ONE samples.
+static short find_best_lag(const INT32 *pi32Cost)
+{
+	return refine_lag(pi32Cost, find_best_index(pi32Cost));
+}
 
+// The find_phase_* functions read the curves from the last call to
+// compute_cost_curves().
+short find_phase_AB(void)
+{
+	UINT32 u32Profile;
+	short phase;
+	
+	PROFILE_START(u32Profile);
+	phase = find_best_lag(ai32CostAB);
+	PROFILE_END(ePROFILE_FIND_PHASE_AB, u32Profile);
+	return phase;
+}
 
+short find_phase_AC(void)
+{
+	UINT32 u32Profile;
+	short phase;
+	
+	PROFILE_START(u32Profile);
+	phase = find_best_lag(ai32CostAC);
+	PROFILE_END(ePROFILE_FIND_PHASE_AC, u32Profile);
+	return phase;
+}
 
+short find_phase_BC(void)
+{
+	UINT32 u32Profile;
+	short phase;
+	
+	PROFILE_START(u32Profile);
+	phase = find_best_lag(ai32CostBC);
+	PROFILE_END(ePROFILE_FIND_PHASE_BC, u32Profile);
+	return phase;
+}
 
+// Estimators.  Both fill the same cost curves, so the best lag search and
+// its sub-sample refinement are shared.  psPhases has DIRDETECT_NUM_SOURCES
+// entries, strongest source first.
+typedef void (*PFN_DIRDETECT_ESTIMATE)(S_DIRDETECT_PHASES *psPhases);
 
+// TRUE if three lags could come from one far away source: the sound gets
+// from A to C by way of B, so lagBC = lagAC - lagAB, give or take the
+// sub-sample fits.
+static BOOL closes_triangle(short i16AB, short i16AC, short i16BC)
+{
+	INT32 i32Closure = i16AC - i16AB - i16BC;
+	
+	return (i32Closure <= DIRDETECT_CLOSURE_TOLERANCE) && (i32Closure >= -DIRDETECT_CLOSURE_TOLERANCE);
+}
 
-// Direction detection processing thread.
-//void dirDetectThread(void const *argument)
-//{
-//	// XXX Initialize ADC hardware to sample microphones.
+// Look for a second source in the minima the best lags left behind.  Each
+// pair offers its best and second best minimum; a combination of them is a
+// source if the BC lag closes the triangle (lagBC = lagAC - lagAB for a far
+// away source) and every minimum it uses is nearly as deep as the best one.
+// The combination of the three best minima is the first source, so it is
+// skipped.  psSecond->u8Sharpness is 0 if nothing fits.
+static void find_second_source(const S_DIRDETECT_PHASES *psFirst, int bestAB, int bestAC, int bestBC,
+							   S_DIRDETECT_PHASES *psSecond)
+{
+	int aiAB[DIRDETECT_NUM_SOURCES], aiAC[DIRDETECT_NUM_SOURCES], aiBC[DIRDETECT_NUM_SOURCES];
+	short ai16BC[DIRDETECT_NUM_SOURCES];
+	int ab, ac, bc;
+	
+	aiAB[0] = bestAB;
+	aiAC[0] = bestAC;
+	aiBC[0] = bestBC;
+	aiAB[1] = find_second_index(ai32CostAB, aiAB[0]);
+	aiAC[1] = find_second_index(ai32CostAC, aiAC[0]);
+	aiBC[1] = find_second_index(ai32CostBC, aiBC[0]);
+	ai16BC[0] = psFirst->i16PhaseBC;
+	ai16BC[1] = (aiBC[1] < 0) ? 0 : refine_lag(ai32CostBC, aiBC[1]);
+	
+	psSecond->u8Sharpness = 0;
+	for(ab = 0; ab<DIRDETECT_NUM_SOURCES; ab++) {
+		short i16AB;
+		
+		if (aiAB[ab] < 0)
+			continue;
+		i16AB = ab ? refine_lag(ai32CostAB, aiAB[ab]) : psFirst->i16PhaseAB;
+		for(ac = 0; ac<DIRDETECT_NUM_SOURCES; ac++) {
+			short i16AC;
+			
+			if ((aiAC[ac] < 0) || (ab + ac == 0))
+				continue;
+			i16AC = ac ? refine_lag(ai32CostAC, aiAC[ac]) : psFirst->i16PhaseAC;
+			for(bc = 0; bc<DIRDETECT_NUM_SOURCES; bc++) {
+				UINT8 u8Sharpness, u8Depth, u8Pair;
+				
+				if ((aiBC[bc] < 0) || !closes_triangle(i16AB, i16AC, ai16BC[bc]))
+					continue;
+				
+				// As deep as its shallowest minimum.
+				u8Depth = minimum_depth(ai32CostAB, aiAB[ab], aiAB[0]);
+				u8Pair = minimum_depth(ai32CostAC, aiAC[ac], aiAC[0]);
+				if (u8Depth > u8Pair)
+					u8Depth = u8Pair;
+				u8Pair = minimum_depth(ai32CostBC, aiBC[bc], aiBC[0]);
+				if (u8Depth > u8Pair)
+					u8Depth = u8Pair;
+				if (u8Depth < DIRDETECT_SECOND_MIN_DEPTH)
+					continue;
+				
+				u8Sharpness = (psFirst->u8Sharpness*u8Depth) >> 4;
+				if (psSecond->u8Sharpness < u8Sharpness) {
+					psSecond->i16PhaseAB = i16AB;
+					psSecond->i16PhaseAC = i16AC;
+					psSecond->i16PhaseBC = ai16BC[bc];
+					psSecond->u8Sharpness = u8Sharpness;
+				}
+			}
+		}
+	}
+}
 
-//	// We loop forever processing direction detection events.
-//	for (;;)
-//	{
-//		// Wait for a signal indicating direction buffers should be processed.
-//		osEvent evt = osSignalWait(0, osWaitForever);
+// Throw away an estimator's answer for a window, so Do_Loop() doesn't pass
+// it on.
+static void reject_phases(S_DIRDETECT_PHASES *psPhases)
+{
+	int source;
+	
+	for(source = 0; source<DIRDETECT_NUM_SOURCES; source++)
+		psPhases[source].u8Sharpness = 0;
+}
 
-//		// Make sure a signal was detected.
-//		if (evt.status != osEventSignal) continue;
-//	
-//		// Process direction detection signal.
-//		if (evt.value.signals & DIRDETECT_SIGNAL_PROCESS) dirDetectProcessBuffers();
-//	}
-//}
+// Fill psPhases[0] with the best lags and psPhases[1] with the second
+// source, if there is one.  A window where any pair's best lag doesn't
+// clearly beat the lags away from it is ambiguous, and one whose best lags
+// don't close the triangle can't be a single source, so both give nothing.
+static void read_phases(S_DIRDETECT_PHASES *psPhases)
+{
+	int bestAB = find_best_index(ai32CostAB);
+	int bestAC = find_best_index(ai32CostAC);
+	int bestBC = find_best_index(ai32CostBC);
+	UINT8 u8Sharpness;
+	
+	psPhases->i16PhaseAB = find_phase_AB();
+	psPhases->i16PhaseAC = find_phase_AC();
+	psPhases->i16PhaseBC = find_phase_BC();
+	
+	// A window is only as good as its worst pair.
+	psPhases->u8Sharpness = minimum_sharpness(ai32CostAB, DIRDETECT_NUM_LAGS, bestAB);
+	u8Sharpness = minimum_sharpness(ai32CostAC, DIRDETECT_NUM_LAGS, bestAC);
+	if (psPhases->u8Sharpness > u8Sharpness)
+		psPhases->u8Sharpness = u8Sharpness;
+	u8Sharpness = minimum_sharpness(ai32CostBC, DIRDETECT_NUM_LAGS, bestBC);
+	if (psPhases->u8Sharpness > u8Sharpness)
+		psPhases->u8Sharpness = u8Sharpness;
+	
+	find_second_source(&psPhases[0], bestAB, bestAC, bestBC, &psPhases[1]);
+	psPhases[0].u8Sector = 0;
+	psPhases[1].u8Sector = 0;
+	
+	if ((sidelobe_level(ai32CostAB, bestAB) >= DIRDETECT_MAX_SIDELOBE) ||
+		(sidelobe_level(ai32CostAC, bestAC) >= DIRDETECT_MAX_SIDELOBE) ||
+		(sidelobe_level(ai32CostBC, bestBC) >= DIRDETECT_MAX_SIDELOBE) ||
+		!closes_triangle(psPhases->i16PhaseAB, psPhases->i16PhaseAC, psPhases->i16PhaseBC))
+		reject_phases(psPhases);
+}
 
+// The normalized correlation of an SSD pair at lag index k, squared, in
+// 256ths (0..255).  The cross term comes back out of the cost and the
+// energies of the two stretches it compared (see cost_all_pairs()):
 //
-// Global Functions
+//   ncc = (energyX + energyY - cost) / (2*sqrt(energyX*energyY))
 //
+// Squared, so there is no square root.  Unlike the cost it doesn't grow
+// with the level, or favour the lags where the shifted stretch is quiet.
+// Anticorrelation gives 0.
+static UINT8 correlation_squared(const UINT32 *pu32EnergyX, const UINT32 *pu32EnergyY, const INT32 *pi32Cost, int k)
+{
+	UINT32 u32X = pu32EnergyX[ADC_BUFFER_SIZE - 2*DIRDETECT_MAX_LAG + k] - pu32EnergyX[k];
+	UINT32 u32Y = pu32EnergyY[ADC_BUFFER_SIZE - DIRDETECT_MAX_LAG] - pu32EnergyY[DIRDETECT_MAX_LAG];
+	INT32 i32Cross = (INT32) (u32X + u32Y - (UINT32) pi32Cost[k]);	// twice the cross term
+	UINT32 u32Cross, u32Num, u32Den;
+	int shift = 0;
+	
+	if (i32Cross <= 0)
+		return 0;
+	
+	// Stay in 32 bits: take each energy down to 15 bits, give what that
+	// took back to one still under 14 bits (which loses nothing), and take
+	// the cross term down by half as much as both together.  An odd shift
+	// leaves the numerator half a bit short, which the denominator makes up.
+	while (u32X >> 15) {
+		u32X >>= 1;
+		shift++;
+	}
+	while (u32Y >> 15) {
+		u32Y >>= 1;
+		shift++;
+	}
+	while (shift && !(u32X >> 14)) {
+		u32X <<= 1;
+		shift--;
+	}
+	while (shift && !(u32Y >> 14)) {
+		u32Y <<= 1;
+		shift--;
+	}
+	u32Cross = (UINT32) i32Cross >> ((shift + 1) >> 1);
+	if (u32Cross > 0xFFFF)
+		u32Cross = 0xFFFF;
+	u32Num = u32Cross*u32Cross;
+	u32Den = (u32X*u32Y) << (2 - (shift & 1));
+	if (u32Num > u32Den)
+		u32Num = u32Den;
+	return (UINT8) fraction(u32Num, u32Den, 8);
+}
 
+// TRUE if every pair correlates at least DIRDETECT_MIN_CORRELATION
+// sixteenths at the lag index given for it.
+static BOOL ssd_correlated(int kAB, int kAC, int kBC)
+{
+	const UINT8 u8Min = DIRDETECT_MIN_CORRELATION*DIRDETECT_MIN_CORRELATION;
+	
+	return (correlation_squared(au32EnergyA, au32EnergyB, ai32CostAB, kAB) >= u8Min) &&
+		   (correlation_squared(au32EnergyA, au32EnergyC, ai32CostAC, kAC) >= u8Min) &&
+		   (correlation_squared(au32EnergyB, au32EnergyC, ai32CostBC, kBC) >= u8Min);
+}
 
-
-// enable direction detection
-void dirDetectInit(void) {
-	init_ADC();
-	start_ADC();
-	for (;;) {
-		Do_Loop();
-	}
+static void estimate_ssd(S_DIRDETECT_PHASES *psPhases)
+{
+	UINT32 u32Profile;
+	
+	PROFILE_START(u32Profile);
+	compute_cost_curves();
+	PROFILE_END(ePROFILE_ESTIMATE, u32Profile);
+	read_phases(psPhases);
+	if (!ssd_correlated(find_best_index(ai32CostAB), find_best_index(ai32CostAC), find_best_index(ai32CostBC)))
+		reject_phases(psPhases);
 }
 
-//void signalSettingFunction(void) {
-//	osSignalSet(dirDetectThreadId, DIRDETECT_SIGNAL_PROCESS);
-//}
+#if DIRDETECT_GCCPHAT
+static void estimate_gccphat(S_DIRDETECT_PHASES *psPhases)
+{
+	UINT32 u32Profile;
+	
+	PROFILE_START(u32Profile);
+	gccPhatCostCurves(pi16ADC_BUF_A, pi16ADC_BUF_B, pi16ADC_BUF_C,
+					  ai32CostAB, ai32CostAC, ai32CostBC);
+	PROFILE_END(ePROFILE_ESTIMATE, u32Profile);
+	read_phases(psPhases);
+}
+#endif
+
+#if DIRDETECT_SRP
+// Steered response power.  Rather than each pair finding its own best lag
+// and the triangle being checked afterwards, each direction in
+// s_ai16SrpLags is scored with the costs of all three pairs at the lags a
+// source there would give, so only lags that close the triangle are ever
+// tried and a pair whose own minimum is off (an echo, a weak mic) is
+// outvoted by the other two.  Lower scores are better.
+static INT32 s_ai32SrpScore[DIRTABLE_SRP_ANGLES];
+static UINT32 s_u32SrpScores = 0;			// directions scored
+static INT8 s_aai8SrpChanged[3][2];		// first and last lag index of each pair srp_refine() last changed
+
+static void correct_phases(S_DIRDETECT_PHASES *psPhases);
+
+// The index of the lag nearest i16Lag (in 1/DIRDETECT_LAG_ONE samples),
+// clamped to the curves.
+static int lag_index(short i16Lag)
+{
+	int k = (((INT32) i16Lag + DIRDETECT_LAG_ONE/2) >> DIRDETECT_LAG_FRAC_BITS) + DIRDETECT_MAX_LAG;
+	
+	if (k < 0)
+		return 0;
+	return (k < DIRDETECT_NUM_LAGS) ? k : DIRDETECT_NUM_LAGS - 1;
+}
+
+// The cost of a pair at i16Lag, straight between the lags either side.
+// Beyond the searched lags the curve is taken to be flat.
+static INT32 cost_at(const INT32 *pi32Cost, short i16Lag)
+{
+	INT32 i32Index = (INT32) i16Lag + (DIRDETECT_MAX_LAG << DIRDETECT_LAG_FRAC_BITS);
+	int k = i32Index >> DIRDETECT_LAG_FRAC_BITS;
+	
+	if (k < 0)
+		return pi32Cost[0];
+	if (k >= DIRDETECT_NUM_LAGS - 1)
+		return pi32Cost[DIRDETECT_NUM_LAGS - 1];
+	return pi32Cost[k] + ((pi32Cost[k + 1] - pi32Cost[k]) >> DIRDETECT_LAG_FRAC_BITS)*(i32Index & (DIRDETECT_LAG_ONE - 1));
+}
+
+// Circular distance between two SRP angles.
+static int srp_distance(int a, int b)
+{
+	int d = (a > b) ? a - b : b - a;
+	
+	return (d > DIRTABLE_SRP_ANGLES/2) ? DIRTABLE_SRP_ANGLES - d : d;
+}
+
+// The lowest score at least DIRDETECT_SRP_SEPARATION angles from the best
+// one, or with bMinimum the lowest local minimum there, -1 if there isn't
+// one.  The angles go all the way round, so every one has neighbours.
+static int srp_lowest_away(int best, BOOL bMinimum)
+{
+	int n, lowest = -1;
+	
+	for(n = 0; n<DIRTABLE_SRP_ANGLES; n++) {
+		INT32 i32Left = s_ai32SrpScore[n ? n - 1 : DIRTABLE_SRP_ANGLES - 1];
+		INT32 i32Right = s_ai32SrpScore[(n < DIRTABLE_SRP_ANGLES - 1) ? n + 1 : 0];
+		
+		if (srp_distance(n, best) < DIRDETECT_SRP_SEPARATION)
+			continue;
+		if (bMinimum && ((s_ai32SrpScore[n] >= i32Left) || (s_ai32SrpScore[n] > i32Right)))
+			continue;
+		if ((lowest < 0) || (s_ai32SrpScore[lowest] > s_ai32SrpScore[n]))
+			lowest = n;
+	}
+	return lowest;
+}
+
+// The lag of pair u8Pair (AB, AC, BC) a source at SRP angle n gives, as
+// the cost curves read it: psOffset is what correct_phases() will take
+// off, negated.
+static short srp_lag(int n, UINT8 u8Pair, const S_DIRDETECT_PHASES *psOffset)
+{
+	if (u8Pair == 0)
+		return s_ai16SrpLags[n][0] - psOffset->i16PhaseAB;
+	if (u8Pair == 1)
+		return s_ai16SrpLags[n][1] - psOffset->i16PhaseAC;
+	return s_ai16SrpLags[n][1] - s_ai16SrpLags[n][0] - psOffset->i16PhaseBC;
+}
+
+// The first of the two lag indices cost_at() reads for pair u8Pair at SRP
+// angle n.
+static int srp_index(int n, UINT8 u8Pair, const S_DIRDETECT_PHASES *psOffset)
+{
+	int k = ((INT32) srp_lag(n, u8Pair, psOffset) + (DIRDETECT_MAX_LAG << DIRDETECT_LAG_FRAC_BITS)) >> DIRDETECT_LAG_FRAC_BITS;
+	
+	if (k < 0)
+		return 0;
+	return (k < DIRDETECT_NUM_LAGS - 1) ? k : DIRDETECT_NUM_LAGS - 2;
+}
+
+// TRUE if SRP angle n reads a cost of any pair srp_refine() last changed.
+static BOOL srp_changed(int n, const S_DIRDETECT_PHASES *psOffset)
+{
+	UINT8 u8Pair;
+	int k;
+	
+	for(u8Pair = 0; u8Pair<3; u8Pair++) {
+		k = srp_index(n, u8Pair, psOffset);
+		if ((k + 1 >= s_aai8SrpChanged[u8Pair][0]) && (k <= s_aai8SrpChanged[u8Pair][1]))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+// Score the directions from the cost curves as they stand, all of them or
+// only those srp_changed() picks, and return the best.  The costs are
+// halved so three of them add up without overflowing.
+static int srp_score(const S_DIRDETECT_PHASES *psOffset, BOOL bAll)
+{
+	int n, best = 0;
+	
+	for(n = 0; n<DIRTABLE_SRP_ANGLES; n++) {
+		if (bAll || srp_changed(n, psOffset)) {
+			s_ai32SrpScore[n] = (cost_at(ai32CostAB, srp_lag(n, 0, psOffset)) >> 1)
+							  + (cost_at(ai32CostAC, srp_lag(n, 1, psOffset)) >> 1)
+							  + (cost_at(ai32CostBC, srp_lag(n, 2, psOffset)) >> 1);
+			s_u32SrpScores++;
+		}
+		if (s_ai32SrpScore[best] > s_ai32SrpScore[n])
+			best = n;
+	}
+	return best;
+}
+
+#if DIRDETECT_COARSE_STEP > 1
+// Evaluate the lags cost_at() reads for SRP angle n and its neighbours,
+// the three the sub-sample fit uses, fill the gaps around them again and
+// note which costs that changed.  Returns FALSE if they all had been
+// evaluated already.
+static BOOL srp_refine(int n, const S_DIRDETECT_PHASES *psOffset)
+{
+	BOOL bNew = FALSE;
+	UINT8 u8Pair, u8Bit;
+	int i, m, j, k, lo, hi;
+	
+	for(u8Pair = 0; u8Pair<3; u8Pair++) {
+		u8Bit = 1 << u8Pair;
+		lo = DIRDETECT_NUM_LAGS;
+		hi = -1;
+		for(i = -1; i<=1; i++) {
+			m = n + i;
+			if (m < 0)
+				m += DIRTABLE_SRP_ANGLES;
+			else if (m >= DIRTABLE_SRP_ANGLES)
+				m -= DIRTABLE_SRP_ANGLES;
+			k = srp_index(m, u8Pair, psOffset);
+			for(j = k; j<=k + 1; j++) {
+				if (s_au8Evaluated[j] & u8Bit)
+					continue;
+				cost_pair(u8Pair, j);
+				if (lo > j)
+					lo = j;
+				if (hi < j)
+					hi = j;
+			}
+		}
+		
+		// fill_gaps() changes the costs out to the evaluated lags either side.
+		if (hi >= 0) {
+			while ((lo > 0) && !(s_au8Evaluated[--lo] & u8Bit))
+				;
+			while ((hi < DIRDETECT_NUM_LAGS - 1) && !(s_au8Evaluated[++hi] & u8Bit))
+				;
+			fill_gaps(u8Pair);
+			bNew = TRUE;
+		}
+		s_aai8SrpChanged[u8Pair][0] = (INT8) lo;
+		s_aai8SrpChanged[u8Pair][1] = (INT8) hi;
+	}
+	return bNew;
+}
+
+// Evaluate the lags under the best direction, and score the directions
+// that changes, until it stays the best.  Returns the best direction.
+static int srp_settle(int best, const S_DIRDETECT_PHASES *psOffset)
+{
+	while (srp_refine(best, psOffset))
+		best = srp_score(psOffset, FALSE);
+	return best;
+}
+#endif
+
+// Compute the cost curves and score every direction, returning the best.
+// With DIRDETECT_COARSE_STEP above one this starts from the SSD search's
+// curves, real along the coarse grid and down each pair's own best valleys
+// and filled from above in between, so a direction scored from filled
+// costs only looks worse than it is.  srp_settle() then makes the best
+// direction's costs real.
+static int srp_search(const S_DIRDETECT_PHASES *psOffset)
+{
+#if DIRDETECT_COARSE_STEP > 1
+	compute_cost_curves();
+	return srp_settle(srp_score(psOffset, TRUE), psOffset);
+#else
+	compute_energies();
+	cost_all_lags(ai32CostAB, ai32CostAC, ai32CostBC);
+	s_u32CostLags += 3*DIRDETECT_NUM_LAGS;
+	return srp_score(psOffset, TRUE);
+#endif
+}
+
+// Fill psPhases with the lags of SRP angle n, which has neither neighbour
+// below it, as the cost curves read them: psOffset is what correct_phases()
+// will take off, negated.  With DIRDETECT_SUBSAMPLE they move towards the
+// lower neighbour's by where a parabola through the three scores bottoms
+// out.
+static void srp_phases(int n, const S_DIRDETECT_PHASES *psOffset, S_DIRDETECT_PHASES *psPhases)
+{
+	INT32 i32AB = s_ai16SrpLags[n][0], i32AC = s_ai16SrpLags[n][1];
+#if DIRDETECT_SUBSAMPLE
+	int left = n ? n - 1 : DIRTABLE_SRP_ANGLES - 1;
+	int right = (n < DIRTABLE_SRP_ANGLES - 1) ? n + 1 : 0;
+	int offset = parabolic_offset(s_ai32SrpScore[left], s_ai32SrpScore[n], s_ai32SrpScore[right]);
+	int toward = right;
+	
+	if (offset < 0) {
+		offset = -offset;
+		toward = left;
+	}
+	i32AB += ((s_ai16SrpLags[toward][0] - i32AB)*offset) >> DIRDETECT_LAG_FRAC_BITS;
+	i32AC += ((s_ai16SrpLags[toward][1] - i32AC)*offset) >> DIRDETECT_LAG_FRAC_BITS;
+#endif
+	psPhases->i16PhaseAB = i32AB - psOffset->i16PhaseAB;
+	psPhases->i16PhaseAC = i32AC - psOffset->i16PhaseAC;
+	psPhases->i16PhaseBC = (i32AC - i32AB) - psOffset->i16PhaseBC;
+	psPhases->u8Sector = 0;
+}
+
+// Score every direction and take the best, and a second valley nearly as
+// deep well away from it as the second source.  The same tests as SSD
+// reject a window: a sidelobe as deep as the best direction, or a pair
+// that doesn't correlate at the lags it was scored at.
+static void estimate_srp(S_DIRDETECT_PHASES *psPhases)
+{
+	S_DIRDETECT_PHASES sOffset;
+	UINT32 u32Profile;
+	INT32 i32Max;
+	int n, best, second;
+	
+	PROFILE_START(u32Profile);
+	memset(&sOffset, 0, sizeof(sOffset));
+	correct_phases(&sOffset);
+	best = srp_search(&sOffset);
+#if DIRDETECT_COARSE_STEP > 1
+	// Score the second source's valley from real costs too, as the SSD
+	// search does.
+	second = srp_lowest_away(best, TRUE);
+	if ((second >= 0) && srp_refine(second, &sOffset))
+		best = srp_settle(srp_score(&sOffset, FALSE), &sOffset);
+#endif
+	PROFILE_END(ePROFILE_ESTIMATE, u32Profile);
+	
+	i32Max = s_ai32SrpScore[0];
+	for(n = 1; n<DIRTABLE_SRP_ANGLES; n++) {
+		if (i32Max < s_ai32SrpScore[n])
+			i32Max = s_ai32SrpScore[n];
+	}
+	
+	srp_phases(best, &sOffset, &psPhases[0]);
+	psPhases[0].u8Sharpness = minimum_sharpness(s_ai32SrpScore, DIRTABLE_SRP_ANGLES, best);
+	psPhases[1].u8Sharpness = 0;
+	psPhases[1].u8Sector = 0;
+	second = srp_lowest_away(best, TRUE);
+	if (second >= 0) {
+		UINT8 u8Depth = (UINT8) fraction((UINT32) i32Max - (UINT32) s_ai32SrpScore[second],
+										 (UINT32) i32Max - (UINT32) s_ai32SrpScore[best], 4);
+		
+		if (u8Depth >= DIRDETECT_SECOND_MIN_DEPTH) {
+			srp_phases(second, &sOffset, &psPhases[1]);
+			psPhases[1].u8Sharpness = (psPhases[0].u8Sharpness*u8Depth) >> 4;
+		}
+	}
+	
+	second = srp_lowest_away(best, FALSE);
+	if ((fraction((UINT32) i32Max - (UINT32) s_ai32SrpScore[second],
+				  (UINT32) i32Max - (UINT32) s_ai32SrpScore[best], 4) >= DIRDETECT_MAX_SIDELOBE) ||
+		!ssd_correlated(lag_index(psPhases[0].i16PhaseAB), lag_index(psPhases[0].i16PhaseAC),
+						lag_index(psPhases[0].i16PhaseBC)))
+		reject_phases(psPhases);
+}
+#endif
+
+#if DIRDETECT_VENDOR
+// DirDetect_Judge() looks at the newest 8.8ms of the capture (decimated to
+// 16kHz as it arrives, see dirDetectProcessBuffers()) rather than the
+// window, and gives one direction.  Its header doesn't say what it
+// returns; this takes 1..12 as the LED in our numbering and anything else
+// as no answer.  DIRDETECT_BENCHMARK shows whether that holds: a fixed
+// rotation puts its agreement in one of the other au32Offset[] bins.
+static void estimate_vendor(S_DIRDETECT_PHASES *psPhases)
+{
+	UINT32 u32Profile;
+	INT32 i32Result;
+	
+	PROFILE_START(u32Profile);
+	i32Result = vendorJudgeRun();
+	PROFILE_END(ePROFILE_ESTIMATE, u32Profile);
+	
+	memset(psPhases, 0, DIRDETECT_NUM_SOURCES*sizeof(S_DIRDETECT_PHASES));
+	if ((i32Result >= 1) && (i32Result <= DIRDETECT_NUM_SECTORS)) {
+		psPhases[0].u8Sector = (UINT8) i32Result;
+		psPhases[0].u8Sharpness = DIRDETECT_VENDOR_SHARPNESS;
+	}
+}
+#endif
+
+// Indexed by E_DIRDETECT_ENGINE; 0 if the estimator isn't built.
+static const PFN_DIRDETECT_ESTIMATE s_apfnEstimate[eDIRDETECT_ENGINE_COUNT] =
+{
+	estimate_ssd,
+#if DIRDETECT_GCCPHAT
+	estimate_gccphat,
+#else
+	0,
+#endif
+#if DIRDETECT_VENDOR
+	estimate_vendor,
+#else
+	0,
+#endif
+#if DIRDETECT_SRP
+	estimate_srp,
+#else
+	0,
+#endif
+};
+
+
+
+
+// Take the scan skew out of an estimator's lags.  B and C are sampled later
+// than A, so a sound reaches them earlier in sample numbers than it really
+// does.
+static void remove_scan_skew(S_DIRDETECT_PHASES *psPhases)
+{
+#if DIRDETECT_SCAN_SKEW_FIX
+	psPhases->i16PhaseAB -= DIRDETECT_SKEW_AB;
+	psPhases->i16PhaseAC -= DIRDETECT_SKEW_AC;
+	psPhases->i16PhaseBC -= DIRDETECT_SKEW_AC - DIRDETECT_SKEW_AB;
+#endif
+}
+
+// Everything that isn't the geometry out of an estimator's lags: the scan
+// skew, then what a source straight above the board reads.
+static void correct_phases(S_DIRDETECT_PHASES *psPhases)
+{
+	remove_scan_skew(psPhases);
+#if DIRDETECT_MIC_CAL
+	psPhases->i16PhaseAB -= s_sCal.i16DelayAB;
+	psPhases->i16PhaseAC -= s_sCal.i16DelayAC;
+	psPhases->i16PhaseBC -= s_sCal.i16DelayAC - s_sCal.i16DelayAB;
+#endif
+}
+
+// Turn a phase into a DirTable.h index, clamped to the table.
+static INT32 dirtable_index(short phase)
+{
+	INT32 i32Index = ((INT32)phase + (1 << (DIRTABLE_STEP_SHIFT - 1))) >> DIRTABLE_STEP_SHIFT;
+	
+	if (i32Index < -DIRTABLE_HALF)
+		i32Index = -DIRTABLE_HALF;
+	else if (i32Index > DIRTABLE_HALF)
+		i32Index = DIRTABLE_HALF;
+	return i32Index + DIRTABLE_HALF;
+}
+
+// Circular distance between two sectors.
+static int sector_distance(int a, int b)
+{
+	int d = (a > b) ? a - b : b - a;
+	
+	return (d > DIRDETECT_NUM_SECTORS/2) ? DIRDETECT_NUM_SECTORS - d : d;
+}
+
+// Evidence in sector k and its two neighbours.  A source near the edge of a
+// sector splits its evidence with the neighbour, so they count together.
+static UINT32 evidence_near(int k)
+{
+	int left = k ? k - 1 : DIRDETECT_NUM_SECTORS - 1;
+	int right = (k < DIRDETECT_NUM_SECTORS - 1) ? k + 1 : 0;
+	
+	return s_au32Evidence[left] + s_au32Evidence[k] + s_au32Evidence[right];
+}
+
+// Add u16Weight of evidence for the direction the phases point at.  The BC
+// phase isn't needed to look the direction up, it follows from the other
+// two.
+void determineDirection(short phaseAB, short phaseAC, UINT16 u16Weight)
+{
+	UINT8 u8Entry;
+	INT32 i32Weight;
+	int k;
+	
+	// Lag pairs no far away source can produce add nothing.
+	u8Entry = s_au8DirTable[dirtable_index(phaseAB)][dirtable_index(phaseAC)];
+	if (DIRTABLE_CONFIDENCE(u8Entry) < DIRDETECT_MIN_CONFIDENCE)
+		return;
+	k = DIRTABLE_SECTOR(u8Entry) - 1;
+	i32Weight = DIRTABLE_CONFIDENCE(u8Entry)*u16Weight;
+	s_au32Evidence[k] += i32Weight;
+	
+	// The lags themselves go in as a vector, so averaging them doesn't
+	// trip over north.  In whole samples, so a sector's sum can't overflow.
+	s_ai32BearingX[k] += (DIRTABLE_BEARING_X(phaseAB, phaseAC)*i32Weight) >> DIRDETECT_LAG_FRAC_BITS;
+	s_ai32BearingY[k] += (DIRTABLE_BEARING_Y(phaseAB, phaseAC)*i32Weight) >> DIRDETECT_LAG_FRAC_BITS;
+}
+
+// atan(2^-i) in sixteenths of a tenth of a degree.
+static const UINT16 s_au16CordicAngle[DIRDETECT_CORDIC_STEPS] =
+{
+	7200, 4250, 2246, 1140, 572, 286, 143, 72, 36, 18, 9, 4, 2, 1
+};
+
+// The direction of (i32X, i32Y), east and north of LED 12, in tenths of a
+// degree clockwise from LED 12 (0..3599).  CORDIC: the vector is turned
+// onto north in steps of atan(2^-i), each one way or the other, and the
+// steps add up to its angle, with no division and no floating point.
+static UINT16 bearing_of(INT32 i32X, INT32 i32Y)
+{
+	INT32 i32Angle = 0;			// sixteenths of a tenth of a degree
+	UINT32 u32Size;
+	int i;
+	
+	// The steps only reach 100 degrees either side of north.
+	if (i32Y < 0) {
+		i32X = -i32X;
+		i32Y = -i32Y;
+		i32Angle = 1800 << 4;
+	}
+	
+	// Enough bits for the last steps, and room for the gain (1.65).
+	u32Size = ((i32X < 0) ? -(UINT32) i32X : (UINT32) i32X) | (UINT32) i32Y;
+	if (!u32Size)
+		return 0;
+	while (u32Size >= (1 << 29)) {
+		i32X >>= 1;
+		i32Y >>= 1;
+		u32Size >>= 1;
+	}
+	while (u32Size < (1 << 13)) {
+		i32X <<= 1;
+		i32Y <<= 1;
+		u32Size <<= 1;
+	}
+	
+	for(i = 0; i<DIRDETECT_CORDIC_STEPS; i++) {
+		INT32 i32Turned;
+		
+		// East of north is clockwise, so turn it back anticlockwise.
+		if (i32X > 0) {
+			i32Turned = i32X - (i32Y >> i);
+			i32Y += i32X >> i;
+			i32Angle += s_au16CordicAngle[i];
+		}
+		else {
+			i32Turned = i32X + (i32Y >> i);
+			i32Y -= i32X >> i;
+			i32Angle -= s_au16CordicAngle[i];
+		}
+		i32X = i32Turned;
+	}
+	
+	if (i32Angle < 0)
+		i32Angle += 3600 << 4;
+	i32Angle = (i32Angle + 8) >> 4;
+	return (i32Angle >= 3600) ? 0 : (UINT16) i32Angle;
+}
+
+// The bearing of the evidence in sector k and its two neighbours, or the
+// middle of sector k if none of it came with lags.
+static UINT16 bearing_near(int k)
+{
+	int left = k ? k - 1 : DIRDETECT_NUM_SECTORS - 1;
+	int right = (k < DIRDETECT_NUM_SECTORS - 1) ? k + 1 : 0;
+	INT32 i32X = s_ai32BearingX[left] + s_ai32BearingX[k] + s_ai32BearingX[right];
+	INT32 i32Y = s_ai32BearingY[left] + s_ai32BearingY[k] + s_ai32BearingY[right];
+	
+	if (!i32X && !i32Y)
+		return (k < DIRDETECT_NUM_SECTORS - 1) ? (k + 1)*DIRDETECT_BEARING_SECTOR : 0;
+	return bearing_of(i32X, i32Y);
+}
+
+#if DIRDETECT_BENCHMARK
+// The LED (1..12) an estimator's strongest source points at, 0 for none.
+static UINT8 phases_sector(const S_DIRDETECT_PHASES *psPhases)
+{
+	S_DIRDETECT_PHASES sCorrected = *psPhases;
+	UINT8 u8Entry;
+	
+	if (!psPhases->u8Sharpness)
+		return 0;
+	if (psPhases->u8Sector)
+		return psPhases->u8Sector;
+	correct_phases(&sCorrected);
+	u8Entry = s_au8DirTable[dirtable_index(sCorrected.i16PhaseAB)][dirtable_index(sCorrected.i16PhaseAC)];
+	return (DIRTABLE_CONFIDENCE(u8Entry) < DIRDETECT_MIN_CONFIDENCE) ? 0 : DIRTABLE_SECTOR(u8Entry);
+}
+
+// Run SSD and DirDetect_Judge() on the same window, each under its own
+// probe, and count how often they agree.  psPhases gets the selected
+// estimator's answer, so the tracker runs as usual.
+static void benchmark(S_DIRDETECT_PHASES *psPhases)
+{
+	S_DIRDETECT_PHASES asSsd[DIRDETECT_NUM_SOURCES], asVendor[DIRDETECT_NUM_SOURCES];
+	UINT32 u32Profile;
+	UINT8 u8Ssd, u8Vendor;
+	
+	PROFILE_START(u32Profile);
+	estimate_ssd(asSsd);
+	PROFILE_END(ePROFILE_BENCH_SSD, u32Profile);
+	PROFILE_START(u32Profile);
+	estimate_vendor(asVendor);
+	PROFILE_END(ePROFILE_BENCH_VENDOR, u32Profile);
+	
+	u8Ssd = phases_sector(asSsd);
+	u8Vendor = phases_sector(asVendor);
+	s_sBench.u32Windows++;
+	if (u8Ssd && u8Vendor)
+		s_sBench.au32Offset[(u8Vendor >= u8Ssd) ? u8Vendor - u8Ssd : u8Vendor + DIRDETECT_NUM_SECTORS - u8Ssd]++;
+	else if (u8Ssd)
+		s_sBench.u32SsdOnly++;
+	else if (u8Vendor)
+		s_sBench.u32VendorOnly++;
+	
+	if (s_eEngine == eDIRDETECT_ENGINE_SSD)
+		memcpy(psPhases, asSsd, sizeof(asSsd));
+	else if (s_eEngine == eDIRDETECT_ENGINE_VENDOR)
+		memcpy(psPhases, asVendor, sizeof(asVendor));
+	else
+		s_apfnEstimate[s_eEngine](psPhases);
+}
+#endif
+
+// Pick the sources out of the evidence and light the LED of the strongest
+// one.  The second source is the strongest sector well clear of the first.
+// Each source's confidence is the share of its evidence against everything
+// that belongs to neither source.
+static void track_report(void)
+{
+	UINT32 u32Total = 0, u32Clutter, au32Near[DIRDETECT_NUM_SOURCES];
+	int aiSector[DIRDETECT_NUM_SOURCES];
+	int k, source;
+	
+	aiSector[0] = 0;
+	for(k = 0; k<DIRDETECT_NUM_SECTORS; k++) {
+		u32Total += s_au32Evidence[k];
+		if (s_au32Evidence[aiSector[0]] < s_au32Evidence[k])
+			aiSector[0] = k;
+	}
+	aiSector[1] = -1;
+	for(k = 0; k<DIRDETECT_NUM_SECTORS; k++) {
+		if (sector_distance(k, aiSector[0]) < DIRDETECT_TRACK_SEPARATION)
+			continue;
+		if ((aiSector[1] < 0) || (s_au32Evidence[aiSector[1]] < s_au32Evidence[k]))
+			aiSector[1] = k;
+	}
+	
+	// Without enough evidence of its own the second source is just clutter.
+	au32Near[0] = evidence_near(aiSector[0]);
+	au32Near[1] = 0;
+	if ((aiSector[1] >= 0) && (s_au32Evidence[aiSector[1]] >= DIRDETECT_TRACK_MIN_EVIDENCE))
+		au32Near[1] = evidence_near(aiSector[1]);
+	u32Clutter = u32Total - au32Near[0] - au32Near[1];
+	
+	for(source = 0; source<DIRDETECT_NUM_SOURCES; source++) {
+		s_au8Confidence[source] = au32Near[source] ? (UINT8) fraction(au32Near[source], au32Near[source] + u32Clutter, 4) : 0;
+		
+		// only report a direction if we are very confident in it
+		if ((s_au32Evidence[aiSector[source]] < DIRDETECT_TRACK_MIN_EVIDENCE) || !au32Near[source] ||
+			(s_au8Confidence[source] < DIRDETECT_TRACK_MIN_CONFIDENCE))
+			continue;
+		s_au8Light[source] = aiSector[source] + 1;
+		if (source == 0) {
+			TurnOff_All();
+			TurnOn_Light(s_au8Light[0]);
+		}
+	}
+	
+	// The first source may have moved onto where the second one was.
+	if (s_au8Light[1] && s_au8Light[0] &&
+		(sector_distance(s_au8Light[1], s_au8Light[0]) < DIRDETECT_TRACK_SEPARATION)) {
+		s_au8Light[1] = 0;
+		s_au8Confidence[1] = 0;
+	}
+	
+	for(source = 0; source<DIRDETECT_NUM_SOURCES; source++) {
+		if (s_au8Light[source])
+			s_au16Bearing[source] = bearing_near(s_au8Light[source] - 1);
+	}
+}
+
+// Age the tracker's evidence by one hop, and drop directions that have
+// faded.  The LEDs go off with the first source.
+static void track_decay(void)
+{
+	int k, source;
+	
+	for(k = 0; k<DIRDETECT_NUM_SECTORS; k++) {
+		s_au32Evidence[k] -= s_au32Evidence[k] >> DIRDETECT_TRACK_DECAY_SHIFT;
+		s_ai32BearingX[k] -= s_ai32BearingX[k] >> DIRDETECT_TRACK_DECAY_SHIFT;
+		s_ai32BearingY[k] -= s_ai32BearingY[k] >> DIRDETECT_TRACK_DECAY_SHIFT;
+	}
+	
+	for(source = 0; source<DIRDETECT_NUM_SOURCES; source++) {
+		if (s_au8Light[source] && (s_au32Evidence[s_au8Light[source] - 1] < DIRDETECT_TRACK_OFF_EVIDENCE)) {
+			s_au8Light[source] = 0;
+			s_au8Confidence[source] = 0;
+			if (source == 0)
+				TurnOff_All();
+		}
+	}
+}
+
+#if DIRDETECT_CLASSIFY
+// Follow mic A's envelopes and zero-crossing rate over the samples
+// u32From..u32To-1, a hop of them unless processing fell behind.  Asleep
+// they stand still, so a sound that wakes the detector rises from the
+// quiet before it.
+static void classify_hop(UINT32 u32From, UINT32 u32To)
+{
+	const INT16 *pi16Ring = s_api16Ring[0];
+	S_CLASSIFIER *psClass = &s_sClassifier;
+	UINT32 u32Sample, u32Energy = 0;
+	INT32 i32Crossings = 0;
+	INT32 i32Last = psClass->i16Last;
+	
+	for(u32Sample = u32From; u32Sample != u32To; u32Sample++) {
+		INT32 i32X = pi16Ring[u32Sample & RING_MASK];
+		
+		u32Energy += (UINT32) (i32X*i32X) >> 2;
+		if ((i32X ^ i32Last) < 0)
+			i32Crossings++;
+		i32Last = i32X;
+	}
+	psClass->i16Last = (INT16) i32Last;
+	
+	// Slope: a transient jumps well above the short envelope in one hop.
+	if ((u32Energy >> DIRDETECT_CLASS_RISE_SHIFT) > psClass->u32Short)
+		psClass->u16SinceRise = 0;
+	else if (psClass->u16SinceRise < 0xFFFF)
+		psClass->u16SinceRise++;
+	psClass->u32Short += (INT32) (u32Energy - psClass->u32Short) >> DIRDETECT_CLASS_SHORT_SHIFT;
+	psClass->u32Long += (INT32) (u32Energy - psClass->u32Long) >> DIRDETECT_CLASS_LONG_SHIFT;
+	
+	// Speech comes and goes with the syllables; a fan doesn't.
+	if (((psClass->u32Short >> 1) < psClass->u32Long) && ((psClass->u32Long >> 1) < psClass->u32Short)) {
+		if (psClass->u16Steady < 0xFFFF)
+			psClass->u16Steady++;
+	}
+	else
+		psClass->u16Steady = 0;
+	
+	psClass->u16Crossings += ((i32Crossings << DIRDETECT_LAG_FRAC_BITS) - psClass->u16Crossings) >> DIRDETECT_CLASS_ZCR_SHIFT;
+}
+
+// The class of the window in pi16ADC_BUF_A/B/C.  The crest factor is
+// compared squared, peak^2 >= crest^2 * mean(x^2), so there is no root
+// and no division.
+static E_DIRDETECT_CLASS classify_window(void)
+{
+	const S_CLASSIFIER *psClass = &s_sClassifier;
+	UINT32 u32Peak = s_ai16WindowPeak[0];
+	UINT32 u32Energy = 0;
+	int i;
+	
+	if (psClass->u16SinceRise <= DIRDETECT_HOPS(DIRDETECT_CLASS_TRANSIENT_MS))
+		return eDIRDETECT_CLASS_TRANSIENT;
+	for(i = 0; i<ADC_BUFFER_SIZE; i++)
+		u32Energy += (UINT32) (pi16ADC_BUF_A[i]*pi16ADC_BUF_A[i]) >> 2;
+	if ((UINT64) ((u32Peak*u32Peak) >> 2)*ADC_BUFFER_SIZE >=
+		(UINT64) (DIRDETECT_CLASS_CREST*DIRDETECT_CLASS_CREST)*u32Energy)
+		return eDIRDETECT_CLASS_TRANSIENT;
+	if (psClass->u16Steady >= DIRDETECT_HOPS(DIRDETECT_CLASS_STEADY_MS))
+		return eDIRDETECT_CLASS_NOISE;
+	return (psClass->u16Crossings <= CLASS_SPEECH_CROSSINGS) ? eDIRDETECT_CLASS_SPEECH : eDIRDETECT_CLASS_NOISE;
+}
+#endif
+
+// Analyse the window in pi16ADC_BUF_A/B/C.  Returns FALSE if it was too soft
+// to use.
+BOOL Do_Loop(void)
+{
+	S_DIRDETECT_PHASES asPhases[DIRDETECT_NUM_SOURCES];
+	UINT32 u32Profile;
+	UINT16 u16Energy = 0;
+	UINT8 u8Mic;
+	int source;
+	
+//	int k;
+
+	// Weight the window 1..4 by how far the loudest mic is above its onset
+	// threshold (x1, x2, x4, x8).
+	for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++) {
+		INT32 i32Threshold = onset_threshold(u8Mic);
+		INT32 i32Peak = s_ai16WindowPeak[u8Mic];
+		UINT16 u16Mic = 0;
+		
+		while ((u16Mic < 4) && (i32Peak >= i32Threshold << u16Mic))
+			u16Mic++;
+		if (u16Energy < u16Mic)
+			u16Energy = u16Mic;
+	}
+	
+	// ignore sounds that are too soft on every mic
+	if (u16Energy == 0) {
+		return FALSE;
+	}
+	
+#if DIRDETECT_CLASSIFY
+	// Nor are the classes nobody asked for worth the estimator's time.
+	s_eClass = classify_window();
+	s_au32ClassWindows[s_eClass]++;
+	if (!(s_u8ClassPolicy & DIRDETECT_CLASS_BIT(s_eClass)))
+		return TRUE;
+#endif
+
+	 
+	// estimate phase
+	s_u32Windows++;
+#if DIRDETECT_BENCHMARK
+	benchmark(asPhases);
+#else
+	s_apfnEstimate[s_eEngine](asPhases);
+#endif
+//	phaseAB = find_phase_AB()*multiplier*2;
+//	phaseAC = find_phase_AC()*multiplier;
+//	phaseBC = find_phase_BC()*multiplier;
+	
+	// A window with nothing to trust leaves the tracker, and so the LEDs
+	// and the I2C registers, as they were.
+	for(source = 0; source<DIRDETECT_NUM_SOURCES; source++) {
+		if (asPhases[source].u8Sharpness)
+			break;
+	}
+	if (source == DIRDETECT_NUM_SOURCES) {
+		s_u32Rejected++;
+		return TRUE;
+	}
+	
+	// determine direction, the tracker does the smoothing
+	PROFILE_START(u32Profile);
+	for(source = 0; source<DIRDETECT_NUM_SOURCES; source++) {
+		if (!asPhases[source].u8Sharpness)
+			continue;
+		if (asPhases[source].u8Sector) {
+			// As sure of it as the best DirTable.h entry.
+			s_au32Evidence[asPhases[source].u8Sector - 1] += 15*asPhases[source].u8Sharpness*u16Energy;
+			continue;
+		}
+		correct_phases(&asPhases[source]);
+		determineDirection(asPhases[source].i16PhaseAB, asPhases[source].i16PhaseAC, asPhases[source].u8Sharpness*u16Energy);
+	}
+	track_report();
+	PROFILE_END(ePROFILE_DETERMINE_DIRECTION, u32Profile);
+	return TRUE;
+}
+
+// Scan the samples that arrived since the last call for the start of a
+// sound on any channel, using the same level test as Do_Loop().  Also keeps
+// the noise floors up to date.
+static void find_onset(UINT32 u32Head)
+{
+	UINT32 u32Sample;
+	UINT32 u32Onset = u32Head;
+	UINT8 u8Mic;
+	
+	// Only what is still in the ring can be scanned.
+	if (u32Head - s_u32Checked > DIRDETECT_RING_SIZE - DIRDETECT_HOP_SIZE)
+		s_u32Checked = u32Head - (DIRDETECT_RING_SIZE - DIRDETECT_HOP_SIZE);
+#if DIRDETECT_CLASSIFY
+	classify_hop(s_u32Checked, u32Head);
+#endif
+	
+	for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++) {
+		const INT16 *pi16Ring = s_api16Ring[u8Mic];
+		INT32 i32Threshold = onset_threshold(u8Mic);
+		INT16 i16Max = 0;
+		
+		for(u32Sample = s_u32Checked; u32Sample != u32Head; u32Sample++) {
+			INT16 i16X = pi16Ring[u32Sample & RING_MASK];
+			
+			if (i16X < 0)
+				i16X = -i16X;
+			if (i16Max < i16X)
+				i16Max = i16X;
+			
+			// Keep the earliest crossing over all the channels.
+			if ((i16X >= i32Threshold) && ((INT32) (u32Sample - u32Onset) < 0))
+				u32Onset = u32Sample;
+		}
+		update_floor(&s_ai32Floor[u8Mic], i16Max);
+	}
+#if DIRDETECT_WAKE_ON_SOUND
+	for(u8Mic = 0; u8Mic<WAKE_MICS; u8Mic++) {
+		update_floor(&s_ai32WakeFloor[u8Mic], s_ai16WakePeak[u8Mic]);
+		s_ai16WakePeak[u8Mic] = 0;
+	}
+#endif
+	
+	if (!s_bEventActive && (u32Onset != u32Head)) {
+		// Start the window early enough that every microphone's onset
+		// lands inside it.
+		s_bEventActive = TRUE;
+		s_u32WindowStart = u32Onset - DIRDETECT_PRE_ONSET;
+		
+		// Don't reach back past the last wake up.
+		if ((INT32) (s_u32WindowStart - s_u32ValidFrom) < 0)
+			s_u32WindowStart = s_u32ValidFrom;
+	}
+	s_u32Checked = u32Head;
+}
+
+// Copy the window starting at u32Start out of the ring.
+static void copy_window(UINT32 u32Start)
+{
+	int i;
+	UINT8 u8Mic;
+	
+	for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++) {
+		const INT16 *pi16Ring = s_api16Ring[u8Mic];
+		INT16 *pi16Window = s_api16Window[u8Mic];
+		INT16 i16Peak = 0;
+		
+		for(i = 0; i<ADC_BUFFER_SIZE; i++) {
+			INT16 i16X = pi16Ring[(u32Start + i) & RING_MASK];
+			
+			pi16Window[i] = i16X;
+			if (i16X < 0)
+				i16X = -i16X;
+			if (i16Peak < i16X)
+				i16Peak = i16X;
+		}
+		s_ai16WindowPeak[u8Mic] = i16Peak;
+	}
+}
+
+#if DIRDETECT_RTX
+// The tracker's output packed into one word, to see when it changes (the
+// bearings are compared on their own).
+static UINT32 track_word(void)
+{
+	UINT32 u32Word = 0;
+	int source;
+	
+	for(source = 0; source<DIRDETECT_NUM_SOURCES; source++)
+		u32Word = (u32Word << 8) | (s_au8Confidence[source] << 4) | s_au8Light[source];
+	return u32Word;
+}
+#endif
+
+// Process the direction detection buffers.
+static void dirDetectProcessBuffers(void)
+{
+	UINT32 u32Head = s_u32Head;
+#if DIRDETECT_RTX
+	UINT32 u32Track = track_word();
+	UINT16 au16Bearing[DIRDETECT_NUM_SOURCES];
+	
+	memcpy(au16Bearing, s_au16Bearing, sizeof(au16Bearing));
+#endif
+	
+#if DIRDETECT_VENDOR
+	// DirDetect_Judge() keeps a longer history than the ring, so every
+	// sample goes into it whether or not a sound has started.
+	if (u32Head - s_u32VendorFed > DIRDETECT_RING_SIZE)
+		s_u32VendorFed = u32Head - DIRDETECT_RING_SIZE;
+	vendorJudgePush(s_api16Ring, s_u32VendorFed, u32Head, RING_MASK);
+	s_u32VendorFed = u32Head;
+#endif
+	find_onset(u32Head);
+#if DIRDETECT_CAPTURE
+	// Until a recording starts the samples are left in the ring, so one
+	// that waits for a sound starts with what came just before it.
+	if (u32Head - s_u32CaptureFed > DIRDETECT_RING_SIZE - DIRDETECT_HOP_SIZE)
+		s_u32CaptureFed = u32Head - (DIRDETECT_RING_SIZE - DIRDETECT_HOP_SIZE);
+	if ((INT32) (s_u32CaptureFed - s_u32ValidFrom) < 0)
+		s_u32CaptureFed = s_u32ValidFrom;
+	if (capturePush(s_api16Tap, s_u32CaptureFed, u32Head, RING_MASK, s_bEventActive))
+		s_u32CaptureFed = u32Head;
+#endif
+#if DIRDETECT_AUDIO_STREAM
+	if (u32Head - s_u32StreamFed > DIRDETECT_RING_SIZE - DIRDETECT_HOP_SIZE)
+		s_u32StreamFed = u32Head - (DIRDETECT_RING_SIZE - DIRDETECT_HOP_SIZE);
+	if ((INT32) (s_u32StreamFed - s_u32ValidFrom) < 0)
+		s_u32StreamFed = s_u32ValidFrom;
+	audioStreamPush(s_api16Tap, s_u32StreamFed, u32Head, RING_MASK);
+	s_u32StreamFed = u32Head;
+#endif
+	track_decay();
+	
+	// Once a sound has started, analyse a window every hop for as long as it
+	// stays loud enough.
+	if (s_bEventActive && (u32Head - s_u32WindowStart >= ADC_BUFFER_SIZE)) {
+		UINT32 u32Behind = u32Head - s_u32WindowStart - ADC_BUFFER_SIZE;
+		
+		// If processing fell behind, skip to the newest complete window on
+		// the hop grid rather than queueing up stale ones.
+		if (u32Behind >= DIRDETECT_HOP_SIZE)
+			s_u32WindowStart += (u32Behind/DIRDETECT_HOP_SIZE)*DIRDETECT_HOP_SIZE;
+		
+		copy_window(s_u32WindowStart);
+		if (Do_Loop())
+			s_u32WindowStart += DIRDETECT_HOP_SIZE;
+		else
+			s_bEventActive = FALSE;
+	}
+	
+#if DIRDETECT_WAKE_ON_SOUND
+	// Go back to sleep once it has been quiet for a while, but not in the
+	// middle of a recording or while someone is listening in.
+	if (s_bEventActive)
+		s_u16QuietHops = 0;
+	else if ((++s_u16QuietHops >= DIRDETECT_WAKE_HOLD_HOPS) && !captureIsRecording() && !audioStreamIsOn())
+		wake_on_sound_arm();
+#endif
+	
+#if DIRDETECT_RTX
+	if (s_tidListener && ((track_word() != u32Track) || memcmp(au16Bearing, s_au16Bearing, sizeof(au16Bearing))))
+		osSignalSet(s_tidListener, s_i32ListenerSignals);
+#endif
+	
+	// Let the ADC interrupt pend us again.
+	s_bProcessing = FALSE;
+}
+
+#if !DIRDETECT_RTX
+// Pended by ADC_IRQHandler (see DIRDETECT_PROCESS_IRQn) each time a frame
+// is ready.
+void USB_IRQHandler(void)
+{
+	UINT32 u32Profile;
+	
+	PROFILE_START(u32Profile);
+	dirDetectProcessBuffers();
+	PROFILE_END(ePROFILE_PROCESS, u32Profile);
+}
+#endif
+
+
+
+
+#if DIRDETECT_MIC_CAL
+// Wait for the next sample and read it, for the polled calibration.  With
+// DIRDETECT_OVERSAMPLE that takes several scans, through the same filter
+// the interrupt uses.
+static void poll_scan(INT16 *pi16Scan)
+{
+	UINT8 u8Mic;
+	
+	for(;;) {
+		while (!DrvADC_GetAdcIntFlag())
+			;
+		DrvADC_ClearAdcIntFlag();
+		for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++)
+			pi16Scan[u8Mic] = DrvADC_GetConversionDataSigned(u8Mic);
+#if (DIRDETECT_OVERSAMPLE > 1)
+		if (decimate_scan(pi16Scan))
+#endif
+			return;
+	}
+}
+
+// Average level of each mic in the quiet.
+static void measure_offsets(INT16 *pi16Offset)
+{
+	INT32 ai32Sum[NUM_CHANNELS] = { 0, 0, 0 };
+	INT16 ai16Scan[NUM_CHANNELS];
+	UINT32 i;
+	UINT8 u8Mic;
+	
+	for(i = 0; i<(1 << DIRDETECT_CAL_OFFSET_SHIFT); i++) {
+		poll_scan(ai16Scan);
+		for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++)
+			ai32Sum[u8Mic] += ai16Scan[u8Mic];
+	}
+	for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++)
+		pi16Offset[u8Mic] = (INT16) ((ai32Sum[u8Mic] + (1 << (DIRDETECT_CAL_OFFSET_SHIFT - 1))) >> DIRDETECT_CAL_OFFSET_SHIFT);
+}
+
+// Record the reference claps into the ring with pi16Offset taken out, and
+// add up the lags each one shows and its level (sum of |x|) on every mic.
+// Returns the number of claps heard before the timeout, leaving out any
+// the estimator rejected.
+static int measure_claps(const INT16 *pi16Offset, UINT32 *pu32Level, INT32 *pi32LagAB, INT32 *pi32LagAC)
+{
+	S_DIRDETECT_PHASES asPhases[DIRDETECT_NUM_SOURCES];
+	INT16 ai16Scan[NUM_CHANNELS];
+	UINT32 u32Sample, u32Onset = 0;
+	UINT32 u32Holdoff = DIRDETECT_RING_SIZE;	// what's in the ring is from before
+	BOOL bClap = FALSE;
+	int claps = 0, i;
+	UINT8 u8Mic;
+	
+	s_u32Head = 0;
+	for(u32Sample = 0; (claps < DIRDETECT_CAL_CLAPS) && (u32Sample < DIRDETECT_CAL_TIMEOUT*SAMPLE_FREQUENCY); u32Sample++) {
+		UINT32 u32Index = s_u32Head & RING_MASK;
+		
+		poll_scan(ai16Scan);
+		for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++) {
+			ai16Scan[u8Mic] -= pi16Offset[u8Mic];
+			if (!u32Holdoff && !bClap &&
+				((ai16Scan[u8Mic] >= DIRDETECT_CAL_LEVEL) || (ai16Scan[u8Mic] <= -DIRDETECT_CAL_LEVEL))) {
+				bClap = TRUE;
+				u32Onset = s_u32Head;
+			}
+		}
+		s_ai16RingA[u32Index] = ai16Scan[0];
+		s_ai16RingB[u32Index] = ai16Scan[1];
+		s_ai16RingC[u32Index] = ai16Scan[2];
+		s_u32Head++;
+		if (u32Holdoff)
+			u32Holdoff--;
+		
+		// Scans missed while this runs don't matter, the holdoff covers them.
+		if (bClap && (s_u32Head - (u32Onset - DIRDETECT_PRE_ONSET) >= ADC_BUFFER_SIZE)) {
+			copy_window(u32Onset - DIRDETECT_PRE_ONSET);
+			estimate_ssd(asPhases);
+			remove_scan_skew(&asPhases[0]);
+			// A window the estimator rejected has no lag to average in: sit
+			// out its holdoff but don't count it.
+			if (asPhases[0].u8Sharpness) {
+				*pi32LagAB += asPhases[0].i16PhaseAB;
+				*pi32LagAC += asPhases[0].i16PhaseAC;
+				for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++) {
+					for(i = 0; i<ADC_BUFFER_SIZE; i++) {
+						INT16 i16X = s_api16Window[u8Mic][i];
+						
+						pu32Level[u8Mic] += (i16X < 0) ? -i16X : i16X;
+					}
+				}
+				claps++;
+			}
+			bClap = FALSE;
+			u32Holdoff = DIRDETECT_CAL_HOLDOFF;
+		}
+	}
+	return claps;
+}
+
+// Work out the calibration from what measure_claps() added up.  Returns
+// FALSE if it is out of range, which is more likely a bad setup than a bad
+// mic.  The divides only happen here, at the factory.
+static BOOL derive_calibration(S_MICCAL *psCal, const UINT32 *pu32Level, INT32 i32LagAB, INT32 i32LagAC)
+{
+	UINT32 u32Gain;
+	UINT8 u8Mic;
+	
+	for(u8Mic = 0; u8Mic<NUM_CHANNELS; u8Mic++) {
+		if (!pu32Level[u8Mic])
+			return FALSE;
+		u32Gain = (UINT32) (((UINT64) pu32Level[0] << MICCAL_GAIN_SHIFT)/pu32Level[u8Mic]);
+		if ((u32Gain < MICCAL_GAIN_ONE/2) || (u32Gain > 2*MICCAL_GAIN_ONE))
+			return FALSE;
+		psCal->au16Gain[u8Mic] = (UINT16) u32Gain;
+	}
+	
+	psCal->i16DelayAB = (INT16) (i32LagAB/DIRDETECT_CAL_CLAPS);
+	psCal->i16DelayAC = (INT16) (i32LagAC/DIRDETECT_CAL_CLAPS);
+	if ((psCal->i16DelayAB > DIRDETECT_CAL_MAX_DELAY) || (psCal->i16DelayAB < -DIRDETECT_CAL_MAX_DELAY) ||
+		(psCal->i16DelayAC > DIRDETECT_CAL_MAX_DELAY) || (psCal->i16DelayAC < -DIRDETECT_CAL_MAX_DELAY))
+		return FALSE;
+	return TRUE;
+}
+#endif
+
+
+
+#if DIRDETECT_RTX
+// Direction detection processing thread.  Between hops it waits on the ADC
+// interrupt's signal, so while the room is quiet (and the ADC interrupt is
+// off, see DIRDETECT_WAKE_ON_SOUND) it never runs.
+static void dirDetectThread(void const *argument)
+{
+	UINT32 u32Profile;
+	
+	// We loop forever processing direction detection events.
+	for (;;)
+	{
+		// Wait for a signal indicating direction buffers should be processed.
+		osEvent evt = osSignalWait(0, osWaitForever);
+
+		// Make sure a signal was detected.
+		if (evt.status != osEventSignal) continue;
+	
+		// Process direction detection signal.
+		if (evt.value.signals & DIRDETECT_SIGNAL_PROCESS) {
+			PROFILE_START(u32Profile);
+			dirDetectProcessBuffers();
+			PROFILE_END(ePROFILE_PROCESS, u32Profile);
+		}
+	}
+}
+
+osThreadDef(dirDetectThread, DIRDETECT_THREAD_PRIORITY, 1, DIRDETECT_THREAD_STACK);
+#endif
+
+//
+// Global Functions
+//
+
+
+
+BOOL dirDetectSetEngine(E_DIRDETECT_ENGINE eEngine)
+{
+	if ((eEngine >= eDIRDETECT_ENGINE_COUNT) || !s_apfnEstimate[eEngine])
+		return FALSE;
+	s_eEngine = eEngine;
+	return TRUE;
+}
+
+E_DIRDETECT_ENGINE dirDetectGetEngine(void)
+{
+	return s_eEngine;
+}
+
+void dirDetectPause(void)
+{
+	NVIC_DisableIRQ(ADC_IRQn);
+}
+
+void dirDetectResume(void)
+{
+	NVIC_EnableIRQ(ADC_IRQn);
+}
+
+UINT16 dirDetectGetOverruns(void)
+{
+	return s_u16Overruns;
+}
+
+UINT32 dirDetectGetWindows(void)
+{
+	return s_u32Windows;
+}
+
+UINT32 dirDetectGetRejected(void)
+{
+	return s_u32Rejected;
+}
+
+UINT32 dirDetectGetCostLags(void)
+{
+	return s_u32CostLags;
+}
+
+#if DIRDETECT_SRP
+UINT32 dirDetectGetSrpScores(void)
+{
+	return s_u32SrpScores;
+}
+#endif
+
+#if DIRDETECT_COARSE_CHECK
+UINT32 dirDetectGetCoarseMisses(void)
+{
+	return s_u32CoarseMisses;
+}
+#endif
+
+#if DIRDETECT_BENCHMARK
+void dirDetectGetBenchmark(S_DIRDETECT_BENCH *psBench)
+{
+	__disable_irq();
+	*psBench = s_sBench;
+	__enable_irq();
+}
+
+void dirDetectResetBenchmark(void)
+{
+	__disable_irq();
+	memset(&s_sBench, 0, sizeof(s_sBench));
+	__enable_irq();
+}
+
+UINT8 dirDetectGetAgreement(void)
+{
+	UINT32 u32Both = 0;
+	int k;
+	
+	for(k = 0; k<DIRDETECT_NUM_SECTORS; k++)
+		u32Both += s_sBench.au32Offset[k];
+	return u32Both ? (UINT8) fraction(s_sBench.au32Offset[0], u32Both, 4) : 0;
+}
+#endif
+
+UINT8 dirDetectGetDirection(UINT8 u8Source)
+{
+	return (u8Source < DIRDETECT_NUM_SOURCES) ? s_au8Light[u8Source] : 0;
+}
+
+UINT8 dirDetectGetConfidence(UINT8 u8Source)
+{
+	return (u8Source < DIRDETECT_NUM_SOURCES) ? s_au8Confidence[u8Source] : 0;
+}
+
+UINT16 dirDetectGetBearing(UINT8 u8Source)
+{
+	if ((u8Source >= DIRDETECT_NUM_SOURCES) || !s_au8Light[u8Source])
+		return DIRDETECT_BEARING_NONE;
+	return s_au16Bearing[u8Source];
+}
+
+#if DIRDETECT_CLASSIFY
+void dirDetectSetClassPolicy(UINT8 u8Classes)
+{
+	s_u8ClassPolicy = u8Classes & DIRDETECT_CLASS_ALL;
+}
+
+UINT8 dirDetectGetClassPolicy(void)
+{
+	return s_u8ClassPolicy;
+}
+
+E_DIRDETECT_CLASS dirDetectGetClass(void)
+{
+	return s_eClass;
+}
+
+UINT32 dirDetectGetClassWindows(E_DIRDETECT_CLASS eClass)
+{
+	if (eClass >= eDIRDETECT_CLASS_COUNT)
+		return 0;
+	return s_au32ClassWindows[eClass];
+}
+#endif
+
+#if DIRDETECT_MIC_CAL
+BOOL dirDetectCalibrate(void)
+{
+	S_MICCAL sCal;
+	UINT32 au32Level[NUM_CHANNELS] = { 0, 0, 0 };
+	INT32 i32LagAB = 0, i32LagAC = 0;
+	BOOL bGood;
+	
+	if (!s_bCapturing) {
+		s_eCalState = eDIRDETECT_CAL_FAILED;
+		return FALSE;
+	}
+	s_eCalState = eDIRDETECT_CAL_RUNNING;
+	
+	// Take the ADC away from the interrupts and poll it.  All the LEDs stay
+	// on while it waits.  The processing thread, being above us, has
+	// already caught up and won't be signalled again.
+#if !DIRDETECT_RTX
+	NVIC_DisableIRQ(DIRDETECT_PROCESS_IRQn);
+#endif
+#if DIRDETECT_WAKE_ON_SOUND
+	if (s_bArmed)
+		wake_on_sound_wake();
+#endif
+	DrvADC_DisableAdcInt();
+	NVIC_DisableIRQ(ADC_IRQn);
+	TurnOn_All();
+	
+	// Measure with the ADC as it is now; the gains and delays are measured
+	// on the raw mics, without the old calibration.
+	sCal = s_sCal;
+	measure_offsets(sCal.ai16Offset);
+	bGood = (measure_claps(sCal.ai16Offset, au32Level, &i32LagAB, &i32LagAC) == DIRDETECT_CAL_CLAPS) &&
+			derive_calibration(&sCal, au32Level, i32LagAB, i32LagAC);
+	if (bGood) {
+		sCal.u16AdcOffsetSetting = ADC.PGCR.OS;
+		sCal.i16AdcAverage = DrvADC_GetAveCalibrationValue();
+		bGood = micCalSave(&sCal);
+	}
+	if (bGood)
+		s_sCal = sCal;
+	s_eCalState = bGood ? eDIRDETECT_CAL_DONE : eDIRDETECT_CAL_FAILED;
+	
+	// Start over with the new calibration.
+	TurnOff_All();
+	memset(s_au32Evidence, 0, sizeof(s_au32Evidence));
+	memset(s_ai32BearingX, 0, sizeof(s_ai32BearingX));
+	memset(s_ai32BearingY, 0, sizeof(s_ai32BearingY));
+	memset(s_au8Light, 0, sizeof(s_au8Light));
+	memset(s_au8Confidence, 0, sizeof(s_au8Confidence));
+#if DIRDETECT_RTX
+	if (s_tidListener)
+		osSignalSet(s_tidListener, s_i32ListenerSignals);
+#else
+	NVIC_ClearPendingIRQ(DIRDETECT_PROCESS_IRQn);
+	NVIC_EnableIRQ(DIRDETECT_PROCESS_IRQn);
+#endif
+	start_ADC();
+	return bGood;
+}
+#else
+BOOL dirDetectCalibrate(void)
+{
+	s_eCalState = eDIRDETECT_CAL_FAILED;
+	return FALSE;
+}
+#endif
+
+void dirDetectWake(void)
+{
+#if DIRDETECT_WAKE_ON_SOUND
+	__disable_irq();
+	if (s_bArmed)
+		wake_on_sound_wake();
+	__enable_irq();
+#endif
+}
+
+void dirDetectRequestCalibration(void)
+{
+	if (s_eCalState != eDIRDETECT_CAL_RUNNING)
+		s_eCalState = eDIRDETECT_CAL_REQUESTED;
+}
+
+E_DIRDETECT_CAL_STATE dirDetectGetCalibrationState(void)
+{
+	return s_eCalState;
+}
+
+// enable direction detection
+void dirDetectInit(void) {
+	init_ADC();
+	
+	// Frames are processed in the thread or the software interrupt, so
+	// this returns.
+#if DIRDETECT_RTX
+	s_tidDetector = osThreadCreate(osThread(dirDetectThread), NULL);
+#else
+	NVIC_SetPriority(DIRDETECT_PROCESS_IRQn, DIRDETECT_PROCESS_PRIORITY);
+	NVIC_ClearPendingIRQ(DIRDETECT_PROCESS_IRQn);
+	NVIC_EnableIRQ(DIRDETECT_PROCESS_IRQn);
+#endif
+	
+	start_ADC();
+}
+
+#if DIRDETECT_RTX
+void dirDetectNotify(osThreadId tid, INT32 i32Signals)
+{
+	s_i32ListenerSignals = i32Signals;
+	s_tidListener = tid;
+}
+#endif
@@ -1,30 +1,353 @@
 #ifndef __DIRDETECT_H
 #define __DIRDETECT_H
 
+#include "VendorJudge.h"
+
+#ifndef DIRDETECT_RTX
+#define DIRDETECT_RTX 1 // process hops in an RTX thread the ADC interrupt signals, rather than in the borrowed USB interrupt (the host replay has no kernel)
+#endif
+#if DIRDETECT_RTX
+#include "cmsis_os.h"
+#endif
+
 //
 // Global Defines and Declarations
 //
 #define SPEED_OF_SOUND 340290 // in mm/s
 #define DISTANCE_BETWEEN_MICS 65 // in mm
+// Mic positions on the board, in degrees clockwise from LED 12.  The mics
+// are the corners of an equilateral triangle DISTANCE_BETWEEN_MICS on a side.
+// DirTable.h is generated from these by gen_dirtable.py.
+#define DIRDETECT_MIC_A_DEG 180
+#define DIRDETECT_MIC_B_DEG 300
+#define DIRDETECT_MIC_C_DEG 60
 #define SOUND_TRAVEL_FREQUENCY (SPEED_OF_SOUND/DISTANCE_BETWEEN_MICS + 1) // 1/(amount of time it take sound to travel from one speaker to another)
+#define DIRDETECT_SUBSAMPLE 1 // refine the best lag of each cost curve to 1/DIRDETECT_LAG_ONE of a sample
+#define DIRDETECT_LOW_RATE 0 // run the ADC at a lower PHASE_ESTIMATION_RESOLUTION and rely on sub-sample refinement for angle resolution
+#if DIRDETECT_LOW_RATE && !DIRDETECT_SUBSAMPLE
+#error "DIRDETECT_LOW_RATE needs DIRDETECT_SUBSAMPLE"
+#endif
+// The #ifndef'd settings below can be overridden on the compiler command line
+// (Replay/sweep.sh builds the host replay harness with different values).
+#ifndef PHASE_ESTIMATION_RESOLUTION
+#if DIRDETECT_LOW_RATE
+#define PHASE_ESTIMATION_RESOLUTION 5
+#else
 #define PHASE_ESTIMATION_RESOLUTION 9  //  minimum number of points needed to sample while sound is travelling from one mic to another (in the longest case) to get useful phase estimates
+#endif
+#endif
 #define P_E_RES PHASE_ESTIMATION_RESOLUTION // easier to read
 #define SAMPLE_FREQUENCY (SOUND_TRAVEL_FREQUENCY*P_E_RES) // necessary sampling frequency to get our phase_estimation_resolution
 #define CYCLES_PER_CONVERSION 25
 #define NUM_CHANNELS 3
-#define ADC_CLOCK_FREQUENCY (SAMPLE_FREQUENCY * CYCLES_PER_CONVERSION * NUM_CHANNELS) // necessary clock rate
+#ifndef DIRDETECT_OVERSAMPLE
+#define DIRDETECT_OVERSAMPLE 1 // ADC scans per sample the detector sees (1, 2 or 4); the extra scans are low-pass filtered away in the ADC interrupt
+#endif
+#ifndef DIRDETECT_NUADCFILTER
+#define DIRDETECT_NUADCFILTER 0 // decimate with NuADCFilterEx's filters (NuADCFilterEx_Keil.lib) rather than the CIC in DirDetect.c
+#endif
+#if (DIRDETECT_OVERSAMPLE != 1) && (DIRDETECT_OVERSAMPLE != 2) && (DIRDETECT_OVERSAMPLE != 4)
+#error "DIRDETECT_OVERSAMPLE must be 1, 2 or 4"
+#endif
+#define ADC_SCAN_FREQUENCY (SAMPLE_FREQUENCY*DIRDETECT_OVERSAMPLE) // scans of all the channels per second
+#define ADC_CLOCK_FREQUENCY (ADC_SCAN_FREQUENCY * CYCLES_PER_CONVERSION * NUM_CHANNELS) // necessary clock rate
 
 
+#ifndef NUM_STF_WAVES_PER_BUFFER
 #define NUM_STF_WAVES_PER_BUFFER 7 // STF = SOUND_TRAVEL_FREQUENCY
+#endif
 #define ADC_BUFFER_SIZE (NUM_STF_WAVES_PER_BUFFER*PHASE_ESTIMATION_RESOLUTION)
+#define DIRDETECT_HOP_SIZE (ADC_BUFFER_SIZE/3) // a new window is analysed this many samples after the last one while a sound lasts
+#define DIRDETECT_RING_SIZE ((ADC_BUFFER_SIZE + 2*DIRDETECT_HOP_SIZE <= 128) ? 128 : 256) // continuous capture per channel, a power of two holding a window and two hops
+#define DIRDETECT_LAG_MARGIN 2 // lags searched beyond P_E_RES either way: the scan skew (under a sample, see DIRDETECT_SKEW_AC) pushes an endfire source past it, and the end lag needs a neighbour for the sub-sample fit
+#define DIRDETECT_MAX_LAG (P_E_RES + DIRDETECT_LAG_MARGIN)
+#define DIRDETECT_NUM_LAGS (2*DIRDETECT_MAX_LAG + 1) // lags -DIRDETECT_MAX_LAG .. DIRDETECT_MAX_LAG are searched
+#define DIRDETECT_PRE_ONSET (2*DIRDETECT_MAX_LAG) // samples kept before the first onset, so the other mics' onsets (up to DIRDETECT_MAX_LAG later) land inside the searched part of the window
+#if (DIRDETECT_RING_SIZE < ADC_BUFFER_SIZE + 2*DIRDETECT_HOP_SIZE) || (DIRDETECT_PRE_ONSET >= ADC_BUFFER_SIZE)
+#error "DIRDETECT_RING_SIZE is too small for the window, hop and pre-onset history"
+#endif
+#define DIRDETECT_FLOOR_FRAC_BITS 8 // the per-mic noise floors are kept in fixed point with this many fractional bits
+#ifndef DIRDETECT_FLOOR_ATTACK_SHIFT
+#define DIRDETECT_FLOOR_ATTACK_SHIFT 6 // each hop the floor rises by 1/2^this of the way to that hop's peak (about 30ms to follow a louder room)...
+#endif
+#ifndef DIRDETECT_FLOOR_RELEASE_SHIFT
+#define DIRDETECT_FLOOR_RELEASE_SHIFT 4 // ...and falls by 1/2^this of the way (about 7ms)
+#endif
+#ifndef DIRDETECT_ONSET_GAIN
+#define DIRDETECT_ONSET_GAIN 10 // a sound starts when any mic reaches this many eighths of its noise floor...
+#endif
+#ifndef DIRDETECT_ONSET_MIN
+#define DIRDETECT_ONSET_MIN 40 // ...and above this level
+#endif
+#ifndef DIRDETECT_MIN_CONFIDENCE
+#define DIRDETECT_MIN_CONFIDENCE 6 // lag pairs DirTable.h gives less confidence than this (0..15) are treated as noise
+#endif
+#ifndef DIRDETECT_MIN_CORRELATION
+#define DIRDETECT_MIN_CORRELATION 8 // SSD windows where any pair's normalized correlation at its best lag is under this many sixteenths never reach the tracker...
+#endif
+#ifndef DIRDETECT_MAX_SIDELOBE
+#define DIRDETECT_MAX_SIDELOBE 15 // ...nor do windows from either estimator where any pair has a minimum DIRDETECT_SOURCE_SEPARATION or more lags from its best one this many sixteenths as deep (16 never rejects)
+#endif
+#define DIRDETECT_NUM_SECTORS 12 // one per LED
+#define DIRDETECT_NUM_SOURCES 2 // directions reported at once, strongest first
+#define DIRDETECT_SOURCE_SEPARATION 3 // a second minimum in a cost curve must be at least this many lags from the best one...
+#define DIRDETECT_CLOSURE_TOLERANCE (DIRDETECT_LAG_ONE + DIRDETECT_LAG_ONE/2) // ...its lags must close the triangle (lagAC - lagAB - lagBC) to within this, as the best ones must or the window is rejected...
+#ifndef DIRDETECT_SECOND_MIN_DEPTH
+#define DIRDETECT_SECOND_MIN_DEPTH 12 // ...and each of its minima must be this many sixteenths as deep as the best one
+#endif
+#define DIRDETECT_TRACK_SEPARATION 3 // sectors between the two sources the tracker reports
+#define DIRDETECT_TRACK_DECAY_SHIFT 7 // each hop the evidence for every sector loses 1/2^this (about 60ms to forget a source)
+#ifndef DIRDETECT_TRACK_MIN_EVIDENCE
+#define DIRDETECT_TRACK_MIN_EVIDENCE 1024 // a sector is reported once it has this much evidence (a window adds up to 15*15*4)...
+#endif
+#ifndef DIRDETECT_TRACK_MIN_CONFIDENCE
+#define DIRDETECT_TRACK_MIN_CONFIDENCE 10 // ...and it and its neighbours hold at least this many sixteenths of all of it
+#endif
+#define DIRDETECT_TRACK_OFF_EVIDENCE (DIRDETECT_TRACK_MIN_EVIDENCE/4) // the LEDs go off when the reported sector decays below this
+#define DIRDETECT_BEARING_SECTOR (3600/DIRDETECT_NUM_SECTORS) // tenths of a degree from one LED to the next
+#define DIRDETECT_BEARING_NONE 0xFFFF // dirDetectGetBearing() of a source with no LED
+#define DIRDETECT_CORDIC_STEPS 14 // the bearing's atan2 is good to 0.01 degrees, well below the noise
+#ifndef DIRDETECT_WAKE_ON_SOUND
+#define DIRDETECT_WAKE_ON_SOUND 1 // while quiet, only the ADC comparators run; the per-sample interrupt starts when mic A or mic C crosses the threshold
+#endif
+#define DIRDETECT_WAKE_SHIFT 1 // the comparators trip at the onset threshold >> this
+#define DIRDETECT_WAKE_HOLD_HOPS (8*ADC_BUFFER_SIZE/DIRDETECT_HOP_SIZE) // quiet hops (8 windows) before going back to the comparators
+#define DIRDETECT_MIC_CAL 1 // correct each mic's offset, gain and delay with the factory calibration in data flash (see MicCal.h)
+// Prefilter.  Each mic goes through a DC blocker and a band-pass biquad on
+// its way into the ring, so the offset drift and the rumble below the band
+// don't swamp the lag search.  All three mics get the same filter, so it
+// delays them all alike and the lags don't move.
+#ifndef DIRDETECT_PREFILTER
+#define DIRDETECT_PREFILTER 1 // filter every sample in the ADC interrupt (about 40 cycles a mic)
+#endif
+#define DIRDETECT_BAND_NONE 0 // the DC blocker alone
+#define DIRDETECT_BAND_SPEECH 1 // voice, 1kHz with a Q of 0.35 (about 350Hz to 2.9kHz)
+#define DIRDETECT_BAND_CLAP 2 // claps and knocks, 2.2kHz with a Q of 0.5 (about 1.2kHz to 4.2kHz)
+#ifndef DIRDETECT_PREFILTER_BAND
+#define DIRDETECT_PREFILTER_BAND DIRDETECT_BAND_CLAP
+#endif
+#define DIRDETECT_DC_BLOCK_SHIFT 8 // the DC blocker's pole is 1 - 1/2^this (about 30Hz)
+// Sound classes.  Every hop mic A's energy envelope and zero-crossing rate
+// are followed, and each window loud enough to use is put in an
+// E_DIRDETECT_CLASS by them and its crest factor.  Only the classes in the
+// policy go on to the estimator; the others keep the sound going but never
+// reach the tracker.
+#ifndef DIRDETECT_CLASSIFY
+#define DIRDETECT_CLASSIFY 1 // classify the windows (about 30 bytes of RAM, 10 cycles a sample)
+#endif
+#ifndef DIRDETECT_CLASS_POLICY
+#define DIRDETECT_CLASS_POLICY (DIRDETECT_CLASS_BIT(eDIRDETECT_CLASS_SPEECH) | DIRDETECT_CLASS_BIT(eDIRDETECT_CLASS_TRANSIENT)) // the classes estimated until dirDetectSetClassPolicy() says otherwise
+#endif
+#define DIRDETECT_HOPS(ms) ((ms)*SAMPLE_FREQUENCY/(1000*DIRDETECT_HOP_SIZE)) // hops in that many milliseconds
+#define DIRDETECT_CLASS_SHORT_SHIFT 5 // the short envelope follows the hops' energy over 2^this hops (about 15ms)...
+#define DIRDETECT_CLASS_LONG_SHIFT 9 // ...and the long one over 2^this (about 230ms)
+#define DIRDETECT_CLASS_RISE_SHIFT 5 // a hop with 2^this times the short envelope's energy (15dB up in half a millisecond) starts a transient...
+#define DIRDETECT_CLASS_TRANSIENT_MS 100 // ...and the windows up to this long after it (a clap and its ring-down) are transient...
+#define DIRDETECT_CLASS_CREST 4 // ...as are windows whose peak on mic A is this many times their RMS
+#define DIRDETECT_CLASS_STEADY_MS 250 // a sound whose short envelope stays within 3dB of the long one this long is steady noise...
+#if (DIRDETECT_PREFILTER && (DIRDETECT_PREFILTER_BAND == DIRDETECT_BAND_CLAP))
+#define DIRDETECT_CLASS_SPEECH_HZ 2000 // ...and one that isn't is speech if mic A crosses zero less than twice this often a second, hiss if more (the band's hiss crosses at about 5kHz, voice nearer its bottom edge)
+#elif (DIRDETECT_PREFILTER && (DIRDETECT_PREFILTER_BAND == DIRDETECT_BAND_SPEECH))
+#define DIRDETECT_CLASS_SPEECH_HZ 1100
+#else
+#define DIRDETECT_CLASS_SPEECH_HZ 1500
+#endif
+#define DIRDETECT_CLASS_ZCR_SHIFT 4 // the zero-crossing rate is averaged over 2^this hops
+#define DIRDETECT_CAL_OFFSET_SHIFT 12 // 1 << this many quiet scans give each mic's offset (about 90ms)
+#define DIRDETECT_CAL_CLAPS 8 // reference claps dirDetectCalibrate() averages
+#define DIRDETECT_CAL_LEVEL 400 // a clap starts when any mic is this far from its offset
+#define DIRDETECT_CAL_HOLDOFF (SAMPLE_FREQUENCY/4) // samples to let a clap die away before looking for the next
+#define DIRDETECT_CAL_TIMEOUT 30 // seconds dirDetectCalibrate() waits for the claps
+#define DIRDETECT_CAL_MAX_DELAY (2*DIRDETECT_LAG_ONE) // a larger delay means the reference wasn't in the middle
+#ifndef DIRDETECT_COARSE_STEP
+#define DIRDETECT_COARSE_STEP (P_E_RES/3) // the SSD search tries every this many lags, then walks down around the best ones, and SRP starts from its curves (1 tries them all)
+#endif
+#ifndef DIRDETECT_COARSE_CHECK
+#define DIRDETECT_COARSE_CHECK 0 // also run the exhaustive SSD search and count the windows where the best lags differ (see dirDetectGetCoarseMisses())
+#endif
+#define DIRDETECT_LAG_FRAC_BITS 4 // phases are reported in fixed point with this many fractional bits
+#define DIRDETECT_LAG_ONE (1 << DIRDETECT_LAG_FRAC_BITS) // one sample of lag
+// The ADC converts the mics one after another in each scan, CYCLES_PER_CONVERSION
+// ADC clocks apart (the sequence is set in init_ADC()), so B and C are
+// sampled later than A and every lag reads that much off.
+#ifndef DIRDETECT_SCAN_SKEW_FIX
+#define DIRDETECT_SCAN_SKEW_FIX 1 // take the scan skew out of the lags before looking up the direction
+#endif
+#define DIRDETECT_SCAN_SLOT_A 0 // conversion of each mic within the scan
+#define DIRDETECT_SCAN_SLOT_B 1
+#define DIRDETECT_SCAN_SLOT_C 2
+#define DIRDETECT_SCAN_SKEW(slots) (((slots)*DIRDETECT_LAG_ONE*CYCLES_PER_CONVERSION*SAMPLE_FREQUENCY + ADC_CLOCK_FREQUENCY/2)/ADC_CLOCK_FREQUENCY) // that many conversions later, in 1/DIRDETECT_LAG_ONE samples
+#define DIRDETECT_SKEW_AB DIRDETECT_SCAN_SKEW(DIRDETECT_SCAN_SLOT_B - DIRDETECT_SCAN_SLOT_A) // 5 (a third of a sample) without DIRDETECT_OVERSAMPLE
+#define DIRDETECT_SKEW_AC DIRDETECT_SCAN_SKEW(DIRDETECT_SCAN_SLOT_C - DIRDETECT_SCAN_SLOT_A)
+
+// Direction estimators.  Each one turns the three ADC buffers into phases
+// (lags in 1/DIRDETECT_LAG_ONE samples) for the AB, AC and BC pairs, or,
+// like the vendor library, straight into an LED.
+#ifndef DIRDETECT_GCCPHAT
+#define DIRDETECT_GCCPHAT 1 // build the GCC-PHAT estimator (about 1.3KB of RAM, twice that for windows over 64 samples)
+#endif
+#ifndef DIRDETECT_SRP
+#define DIRDETECT_SRP 1 // build the steered-response-power estimator (about 300 bytes of RAM)
+#endif
+#define DIRDETECT_SRP_SEPARATION (DIRTABLE_SRP_ANGLES*DIRDETECT_TRACK_SEPARATION/DIRDETECT_NUM_SECTORS) // SRP angles between its best direction and a second source or a sidelobe
+#define DIRDETECT_VENDOR_SHARPNESS 8 // DirDetect_Judge() only gives an LED, so each answer counts as this sharp (0..15)
+#ifndef DIRDETECT_BENCHMARK
+#define DIRDETECT_BENCHMARK 0 // run SSD and DirDetect_Judge() on every window, time both and compare their LEDs (see dirDetectGetBenchmark())
+#endif
+#if DIRDETECT_BENCHMARK && !DIRDETECT_VENDOR
+#error "DIRDETECT_BENCHMARK needs DIRDETECT_VENDOR"
+#endif
+
+typedef enum {
+	eDIRDETECT_ENGINE_SSD,		// time domain sum-of-squared-differences search
+	eDIRDETECT_ENGINE_GCCPHAT,	// frequency domain cross correlation with phase transform
+	eDIRDETECT_ENGINE_VENDOR,	// Nuvoton's DirDetect_Judge() on a 16kHz copy of the capture (see VendorJudge.h)
+	eDIRDETECT_ENGINE_SRP,		// the SSD cost curves of all three pairs summed along each direction DirTable.h steers to
+	eDIRDETECT_ENGINE_COUNT
+} E_DIRDETECT_ENGINE;
+
+#define DIRDETECT_ENGINE_DEFAULT eDIRDETECT_ENGINE_SSD
+
+typedef enum {
+	eDIRDETECT_CLASS_SPEECH,	// voice: comes and goes, mostly low frequencies
+	eDIRDETECT_CLASS_TRANSIENT,	// claps and knocks: a sharp rise or a high crest factor
+	eDIRDETECT_CLASS_NOISE,		// fans and motor whine (steady) or hiss
+	eDIRDETECT_CLASS_COUNT
+} E_DIRDETECT_CLASS;
+
+#define DIRDETECT_CLASS_BIT(c) (1 << (c))
+#define DIRDETECT_CLASS_ALL (DIRDETECT_CLASS_BIT(eDIRDETECT_CLASS_COUNT) - 1)
+
+typedef enum {
+	eDIRDETECT_CAL_NONE,		// nothing in data flash, the mics are used as they are
+	eDIRDETECT_CAL_LOADED,		// read from data flash at boot
+	eDIRDETECT_CAL_REQUESTED,	// dirDetectRequestCalibration() was called
+	eDIRDETECT_CAL_RUNNING,		// waiting for the reference claps
+	eDIRDETECT_CAL_DONE,		// measured and saved
+	eDIRDETECT_CAL_FAILED		// too few claps, a reading out of range or the flash write failed; the old values stay
+} E_DIRDETECT_CAL_STATE;
+
+typedef struct {
+	INT16 i16PhaseAB;
+	INT16 i16PhaseAC;
+	INT16 i16PhaseBC;
+	UINT8 u8Sharpness;			// how clearly the best lags stand out of the worst cost curve, 0..15
+	UINT8 u8Sector;				// the LED (1..12) if the estimator found it itself and the phases are unused, else 0
+} S_DIRDETECT_PHASES;
+
+// What DIRDETECT_BENCHMARK has seen since the last dirDetectResetBenchmark().
+// The time each estimator takes is in the profiler ("bench ssd" and
+// "bench vendor").
+typedef struct {
+	UINT32 u32Windows;			// windows both estimators ran on
+	UINT32 u32SsdOnly;			// ...where only SSD found an LED
+	UINT32 u32VendorOnly;		// ...where only DirDetect_Judge() did
+	UINT32 au32Offset[DIRDETECT_NUM_SECTORS];	// ...where both did, by how many LEDs clockwise the vendor's is; [0] is agreement
+} S_DIRDETECT_BENCH;
 
 //
 // Global Functions
 //
 
-// Init
+// Init.  Starts continuous capture and returns; frames are processed in the
+// detector thread (DIRDETECT_RTX) or a low priority interrupt.  With RTX it
+// has to be called from a thread, after the kernel has started.
 void dirDetectInit(void);
 
+#if DIRDETECT_RTX
+// Send i32Signals to thread tid whenever the tracker's output (what
+// dirDetectGetDirection(), dirDetectGetConfidence() and
+// dirDetectGetBearing() return) changes.
+void dirDetectNotify(osThreadId tid, INT32 i32Signals);
+#endif
+
+// Factory calibration.  Place a reference source (a clicker or a clap)
+// straight above the middle of the board, so it is equally far from every
+// mic, keep the room quiet for the first 100ms and then make
+// DIRDETECT_CAL_CLAPS sounds a quarter of a second or more apart.  Measures
+// each mic's DC offset, its gain against mic A and the lag each pair shows,
+// saves them to data flash and starts using them.  Blocks (polling the
+// ADC) until done or DIRDETECT_CAL_TIMEOUT has passed; call it from the
+// main loop (or a thread below the detector's priority) after dirDetectInit().
+BOOL dirDetectCalibrate(void);
+
+// Ask for dirDetectCalibrate() to be run (e.g. from the I2C slave).
+void dirDetectRequestCalibration(void);
+E_DIRDETECT_CAL_STATE dirDetectGetCalibrationState(void);
+
+// Start sampling every conversion now if the detector is asleep on the
+// comparators (DIRDETECT_WAKE_ON_SOUND), as if a sound had woken it.
+void dirDetectWake(void);
+
+// Mask and unmask the ADC interrupt (e.g. around bit-banged I2C), leaving
+// the capture or wake-on-sound state as it was.
+void dirDetectPause(void);
+void dirDetectResume(void);
+
+// Number of hops where the previous one was still being processed.
+UINT16 dirDetectGetOverruns(void);
+
+// Number of windows the estimator has been run on.
+UINT32 dirDetectGetWindows(void);
+
+// Windows the estimator gave no answer for, or one too ambiguous to trust
+// (see DIRDETECT_MIN_CORRELATION), which were dropped before the tracker,
+// the LEDs or the I2C registers saw them.
+UINT32 dirDetectGetRejected(void);
+
+// Pair-lags the SSD search has evaluated, three per lag tried.  The SRP
+// estimator's count here too.
+UINT32 dirDetectGetCostLags(void);
+
+#if DIRDETECT_SRP
+// Directions the SRP estimator has scored, each from three cost curves.
+UINT32 dirDetectGetSrpScores(void);
+#endif
+
+#if DIRDETECT_COARSE_CHECK
+// Windows where the coarse-to-fine SSD search found a different best lag
+// than the exhaustive one for any pair.
+UINT32 dirDetectGetCoarseMisses(void);
+#endif
+
+// The LED (1..12) the tracker currently reports for source u8Source
+// (0 being the strongest, up to DIRDETECT_NUM_SOURCES - 1), 0 if none, and
+// how much of the recent evidence points that way (0..15).
+UINT8 dirDetectGetDirection(UINT8 u8Source);
+UINT8 dirDetectGetConfidence(UINT8 u8Source);
+
+// The direction of source u8Source in tenths of a degree clockwise from
+// LED 12 (0..3599): the average of the lags of the windows behind its LED,
+// or the middle of the sector if none of them had lags (the vendor
+// estimator's).  DIRDETECT_BEARING_NONE if there is no LED.
+UINT16 dirDetectGetBearing(UINT8 u8Source);
+
+#if DIRDETECT_CLASSIFY
+// The classes (a mask of DIRDETECT_CLASS_BIT()s) whose windows go on to
+// the estimator, DIRDETECT_CLASS_POLICY at boot.
+void dirDetectSetClassPolicy(UINT8 u8Classes);
+UINT8 dirDetectGetClassPolicy(void);
+
+// The class of the last window loud enough to use, and how many windows
+// have been put in class eClass (estimated or not).
+E_DIRDETECT_CLASS dirDetectGetClass(void);
+UINT32 dirDetectGetClassWindows(E_DIRDETECT_CLASS eClass);
+#endif
+
+// Select the estimator used for the next frames.  Returns FALSE if that
+// estimator isn't built in.
+BOOL dirDetectSetEngine(E_DIRDETECT_ENGINE eEngine);
+E_DIRDETECT_ENGINE dirDetectGetEngine(void);
+
+#if DIRDETECT_BENCHMARK
+void dirDetectGetBenchmark(S_DIRDETECT_BENCH *psBench);
+void dirDetectResetBenchmark(void);
+
+// Sixteenths (0..15) of the windows both estimators found an LED for where
+// they found the same one.
+UINT8 dirDetectGetAgreement(void);
+#endif
+
 #endif // __DIRDETECT_H
 
 
@@ -0,0 +1,144 @@
+// Generated by gen_dirtable.py from DirDetect.h, don't edit.
+//
+// s_au8DirTable[lagAB][lagAC] holds the LED (1..12) a far away source with
+// those lags would light in the low nibble, and in the high nibble how close
+// the lag pair is to one a real source can produce (0..15).  Lags are in
+// 1/2 samples and offset by DIRTABLE_HALF.
+//
+// s_ai16SrpLags[n] holds the lagAB and lagAC, in 1/DIRDETECT_LAG_ONE samples,
+// of a far away source n*360/DIRTABLE_SRP_ANGLES degrees clockwise from
+// LED 12.
+//
+// DIRTABLE_BEARING_X(ab, ac) and DIRTABLE_BEARING_Y(ab, ac) turn the lags of a
+// far away source back into its direction, east and north of LED 12, as long
+// as the lag of a source in line with two mics.
+
+#ifndef __DIRTABLE_H
+#define __DIRTABLE_H
+
+#if (SPEED_OF_SOUND != 340290) || (DISTANCE_BETWEEN_MICS != 65) || \
+    (DIRDETECT_MIC_A_DEG != 180) || (DIRDETECT_MIC_B_DEG != 300) || (DIRDETECT_MIC_C_DEG != 60) || \
+    (DIRDETECT_LAG_FRAC_BITS != 4)
+#error "DirTable.h is out of date, run gen_dirtable.py"
+#endif
+
+#define DIRTABLE_STEP_SHIFT		(DIRDETECT_LAG_FRAC_BITS - 1)
+#define DIRTABLE_SECTOR(x)		((x) & 0x0F)
+#define DIRTABLE_CONFIDENCE(x)	((x) >> 4)
+#define DIRTABLE_SRP_ANGLES		72
+#define DIRTABLE_BEARING_X(ab, ac)	(((ab)*-256 + (ac)*256) >> 8)
+#define DIRTABLE_BEARING_Y(ab, ac)	(((ab)*148 + (ac)*148) >> 8)
+
+#if (SAMPLE_FREQUENCY == 47124)
+
+#define DIRTABLE_HALF			18
+#define DIRTABLE_SIZE			(2*DIRTABLE_HALF + 1)
+
+static const UINT8 s_au8DirTable[DIRTABLE_SIZE][DIRTABLE_SIZE] = {
+	{0x46,0x66,0x86,0xA6,0xB6,0xD6,0xE5,0xE5,0xF5,0xF5,0xF5,0xF5,0xE5,0xD5,0xC4,0xB4,0xA4,0x94,0x84,0x64,0x54,0x34,0x24,0x04,0x04,0x04,0x04,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03},
+	{0x66,0x86,0xB6,0xD6,0xE6,0xE6,0xD5,0xC5,0xC5,0xC5,0xC5,0xC5,0xD5,0xD5,0xE4,0xF4,0xD4,0xC4,0xB4,0x94,0x84,0x64,0x44,0x34,0x14,0x04,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03},
+	{0x86,0xB6,0xD6,0xF6,0xD6,0xB6,0xA5,0x95,0x85,0x85,0x85,0x95,0x95,0xA4,0xB4,0xC4,0xD4,0xF4,0xE4,0xC4,0xB4,0x94,0x74,0x54,0x44,0x24,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03},
+	{0xA6,0xD6,0xF6,0xC6,0xA6,0x86,0x76,0x65,0x55,0x55,0x55,0x65,0x65,0x74,0x84,0x94,0xA4,0xC4,0xD4,0xF4,0xE4,0xC4,0xA4,0x84,0x64,0x43,0x23,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03},
+	{0xB6,0xE6,0xD6,0xA6,0x86,0x56,0x46,0x25,0x25,0x25,0x25,0x25,0x35,0x44,0x54,0x64,0x74,0x94,0xA4,0xC4,0xE4,0xF4,0xD4,0xB4,0x93,0x73,0x53,0x33,0x13,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03},
+	{0xD6,0xE6,0xB6,0x86,0x56,0x36,0x16,0x05,0x05,0x05,0x05,0x05,0x05,0x14,0x24,0x34,0x44,0x64,0x74,0x94,0xB4,0xD4,0xE4,0xE3,0xC3,0xA3,0x73,0x53,0x33,0x13,0x03,0x03,0x03,0x03,0x03,0x03,0x03},
+	{0xE7,0xD7,0xA7,0x76,0x46,0x16,0x06,0x06,0x05,0x05,0x05,0x05,0x04,0x04,0x04,0x04,0x14,0x34,0x44,0x64,0x84,0xA4,0xC4,0xE3,0xE3,0xC3,0xA3,0x83,0x53,0x33,0x13,0x03,0x03,0x03,0x03,0x03,0x03},
+	{0xE7,0xC7,0x97,0x67,0x27,0x07,0x06,0x06,0x05,0x05,0x05,0x05,0x04,0x04,0x04,0x04,0x04,0x04,0x24,0x34,0x54,0x74,0x93,0xB3,0xD3,0xF3,0xC3,0xA3,0x83,0x63,0x33,0x13,0x03,0x03,0x03,0x03,0x03},
+	{0xF7,0xC7,0x87,0x57,0x27,0x07,0x07,0x07,0x07,0x05,0x05,0x05,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x14,0x24,0x43,0x63,0x93,0xB3,0xD3,0xF3,0xD3,0xA3,0x83,0x53,0x33,0x13,0x03,0x03,0x03,0x03},
+	{0xF7,0xC7,0x87,0x57,0x27,0x07,0x07,0x07,0x07,0x05,0x05,0x05,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x03,0x23,0x43,0x63,0x83,0xA3,0xD3,0xF3,0xD3,0xA3,0x83,0x53,0x33,0x03,0x03,0x03,0x03},
+	{0xF7,0xC7,0x87,0x57,0x27,0x07,0x07,0x07,0x07,0x07,0x05,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x03,0x03,0x13,0x33,0x63,0x83,0xA3,0xD3,0xF3,0xC3,0xA3,0x73,0x53,0x23,0x03,0x03,0x02},
+	{0xF7,0xC7,0x97,0x67,0x27,0x07,0x07,0x07,0x07,0x07,0x08,0x08,0x04,0x04,0x04,0x04,0x04,0x04,0x04,0x03,0x03,0x03,0x03,0x13,0x33,0x63,0x83,0xA3,0xD3,0xF3,0xC3,0xA3,0x73,0x43,0x22,0x02,0x02},
+	{0xE7,0xD7,0x97,0x67,0x37,0x07,0x08,0x08,0x08,0x08,0x08,0x08,0x04,0x04,0x04,0x04,0x04,0x04,0x03,0x03,0x03,0x03,0x03,0x03,0x13,0x33,0x63,0x83,0xB3,0xD3,0xE3,0xC3,0x93,0x62,0x42,0x12,0x02},
+	{0xD7,0xD7,0xA8,0x78,0x48,0x18,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x04,0x04,0x04,0x04,0x04,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x13,0x33,0x63,0x93,0xB3,0xE3,0xE3,0xB2,0x82,0x52,0x32,0x02},
+	{0xC8,0xE8,0xB8,0x88,0x58,0x28,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x04,0x04,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x13,0x43,0x63,0x93,0xC2,0xE2,0xD2,0xA2,0x72,0x42,0x22},
+	{0xB8,0xF8,0xC8,0x98,0x68,0x38,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x04,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x23,0x43,0x72,0xA2,0xD2,0xF2,0xC2,0x92,0x62,0x32},
+	{0xA8,0xD8,0xD8,0xA8,0x78,0x48,0x18,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x09,0x09,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x22,0x52,0x82,0xB2,0xE2,0xE2,0xB2,0x82,0x52},
+	{0x98,0xC8,0xF8,0xC8,0x98,0x68,0x38,0x08,0x08,0x08,0x08,0x08,0x08,0x08,0x09,0x09,0x09,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x02,0x02,0x12,0x32,0x62,0x92,0xC2,0xF2,0xC2,0x92,0x62},
+	{0x88,0xB8,0xE8,0xD8,0xA8,0x78,0x48,0x28,0x08,0x08,0x08,0x08,0x09,0x09,0x09,0x09,0x09,0x09,0x03,0x03,0x03,0x03,0x03,0x03,0x03,0x02,0x02,0x02,0x02,0x22,0x42,0x72,0xA2,0xD2,0xE2,0xB2,0x82},
+	{0x68,0x98,0xC8,0xF8,0xC8,0x98,0x68,0x38,0x18,0x08,0x08,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x03,0x03,0x03,0x03,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x32,0x62,0x92,0xC2,0xF2,0xC2,0x92},
+	{0x58,0x88,0xB8,0xE8,0xE8,0xB8,0x88,0x58,0x28,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x03,0x03,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x12,0x42,0x72,0xA2,0xD2,0xD2,0xA2},
+	{0x38,0x68,0x98,0xC8,0xF8,0xD8,0xA8,0x78,0x49,0x29,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x32,0x62,0x92,0xC2,0xF2,0xB2},
+	{0x28,0x48,0x78,0xA8,0xD8,0xE8,0xC8,0x99,0x69,0x49,0x19,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x0A,0x0A,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x22,0x52,0x82,0xB2,0xE2,0xC2},
+	{0x08,0x38,0x58,0x88,0xB8,0xE9,0xE9,0xB9,0x99,0x69,0x39,0x19,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x0A,0x0A,0x0A,0x0A,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x12,0x42,0x72,0xA2,0xD1,0xD1},
+	{0x08,0x18,0x48,0x68,0x99,0xC9,0xE9,0xD9,0xB9,0x89,0x69,0x39,0x19,0x09,0x09,0x09,0x09,0x09,0x09,0x0A,0x0A,0x0A,0x0A,0x0A,0x02,0x02,0x02,0x02,0x02,0x02,0x02,0x01,0x31,0x61,0x91,0xD1,0xE1},
+	{0x08,0x08,0x28,0x49,0x79,0xA9,0xC9,0xF9,0xD9,0xA9,0x89,0x69,0x39,0x19,0x09,0x09,0x09,0x09,0x0A,0x0A,0x0A,0x0A,0x0A,0x0A,0x0A,0x02,0x02,0x01,0x01,0x01,0x01,0x01,0x21,0x61,0x91,0xC1,0xF1},
+	{0x08,0x09,0x09,0x29,0x59,0x79,0xA9,0xC9,0xF9,0xD9,0xA9,0x89,0x69,0x39,0x19,0x09,0x09,0x0A,0x0A,0x0A,0x0A,0x0A,0x0A,0x0A,0x0A,0x0A,0x01,0x01,0x01,0x01,0x01,0x01,0x21,0x51,0x81,0xC1,0xF1},
+	{0x09,0x09,0x09,0x09,0x39,0x59,0x89,0xA9,0xD9,0xF9,0xD9,0xA9,0x89,0x69,0x49,0x29,0x09,0x0A,0x0A,0x0A,0x0A,0x0A,0x0A,0x0A,0x0A,0x0B,0x0B,0x01,0x01,0x01,0x01,0x01,0x21,0x51,0x81,0xC1,0xF1},
+	{0x09,0x09,0x09,0x09,0x19,0x39,0x59,0x89,0xA9,0xD9,0xF9,0xD9,0xB9,0x99,0x69,0x49,0x2A,0x1A,0x0A,0x0A,0x0A,0x0A,0x0A,0x0A,0x0A,0x0B,0x0B,0x0B,0x01,0x01,0x01,0x01,0x21,0x51,0x81,0xC1,0xF1},
+	{0x09,0x09,0x09,0x09,0x09,0x19,0x39,0x69,0x89,0xA9,0xC9,0xF9,0xD9,0xB9,0x99,0x7A,0x5A,0x3A,0x2A,0x0A,0x0A,0x0A,0x0A,0x0A,0x0A,0x0B,0x0B,0x0B,0x0B,0x0C,0x0C,0x01,0x21,0x61,0x91,0xC1,0xE1},
+	{0x09,0x09,0x09,0x09,0x09,0x09,0x19,0x39,0x59,0x89,0xA9,0xC9,0xE9,0xE9,0xCA,0xAA,0x8A,0x6A,0x4A,0x3A,0x1A,0x0A,0x0A,0x0A,0x0A,0x0B,0x0B,0x0B,0x0B,0x0C,0x0C,0x1C,0x4C,0x7C,0xA1,0xD1,0xE1},
+	{0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x19,0x39,0x59,0x79,0xA9,0xC9,0xE9,0xEA,0xDA,0xBA,0x9A,0x7A,0x6A,0x4A,0x3A,0x2A,0x1A,0x0B,0x0B,0x0B,0x0B,0x0B,0x0B,0x1C,0x3C,0x5C,0x8C,0xBC,0xEC,0xDC},
+	{0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x19,0x39,0x59,0x79,0x99,0xBA,0xDA,0xFA,0xEA,0xCA,0xAA,0x9A,0x7A,0x6A,0x5A,0x4A,0x3B,0x2B,0x2B,0x2B,0x2B,0x2B,0x4C,0x5C,0x8C,0xAC,0xDC,0xEC,0xBC},
+	{0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x29,0x49,0x6A,0x8A,0xAA,0xCA,0xEA,0xFA,0xDA,0xCA,0xAA,0x9A,0x8A,0x7A,0x6B,0x6B,0x5B,0x5B,0x5B,0x6B,0x7C,0x8C,0xAC,0xCC,0xFC,0xDC,0xAC},
+	{0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x2A,0x4A,0x5A,0x7A,0x9A,0xBA,0xCA,0xEA,0xFA,0xDA,0xCA,0xBA,0xAA,0x9B,0x9B,0x8B,0x8B,0x8B,0x9B,0xAB,0xBC,0xDC,0xFC,0xDC,0xBC,0x8C},
+	{0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x0A,0x1A,0x3A,0x4A,0x6A,0x8A,0x9A,0xBA,0xCA,0xDA,0xFA,0xEA,0xDB,0xDB,0xCB,0xCB,0xCB,0xCB,0xCB,0xDB,0xEC,0xEC,0xDC,0xBC,0x8C,0x6C},
+	{0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x09,0x0A,0x0A,0x0A,0x0A,0x2A,0x3A,0x5A,0x6A,0x8A,0x9A,0xAA,0xBA,0xCA,0xDB,0xEB,0xFB,0xFB,0xFB,0xFB,0xEB,0xEB,0xDC,0xBC,0xAC,0x8C,0x6C,0x4C},
+};
+
+#if DIRDETECT_SRP
+static const INT16 s_ai16SrpLags[DIRTABLE_SRP_ANGLES][2] = {
+	{125,125}, {118,131}, {110,135}, {102,139}, {93,142}, {83,143},
+	{72,144}, {61,143}, {49,142}, {37,139}, {25,135}, {13,131},
+	{0,125}, {-13,118}, {-25,110}, {-37,102}, {-49,93}, {-61,83},
+	{-72,72}, {-83,61}, {-93,49}, {-102,37}, {-110,25}, {-118,13},
+	{-125,0}, {-131,-13}, {-135,-25}, {-139,-37}, {-142,-49}, {-143,-61},
+	{-144,-72}, {-143,-83}, {-142,-93}, {-139,-102}, {-135,-110}, {-131,-118},
+	{-125,-125}, {-118,-131}, {-110,-135}, {-102,-139}, {-93,-142}, {-83,-143},
+	{-72,-144}, {-61,-143}, {-49,-142}, {-37,-139}, {-25,-135}, {-13,-131},
+	{0,-125}, {13,-118}, {25,-110}, {37,-102}, {49,-93}, {61,-83},
+	{72,-72}, {83,-61}, {93,-49}, {102,-37}, {110,-25}, {118,-13},
+	{125,0}, {131,13}, {135,25}, {139,37}, {142,49}, {143,61},
+	{144,72}, {143,83}, {142,93}, {139,102}, {135,110}, {131,118},
+};
+#endif
+
+#elif (SAMPLE_FREQUENCY == 26180)
+
+#define DIRTABLE_HALF			10
+#define DIRTABLE_SIZE			(2*DIRTABLE_HALF + 1)
+
+static const UINT8 s_au8DirTable[DIRTABLE_SIZE][DIRTABLE_SIZE] = {
+	{0x46,0x86,0xB6,0xD5,0xF5,0xF5,0xF5,0xE5,0xC4,0xA4,0x84,0x54,0x24,0x04,0x04,0x03,0x03,0x03,0x03,0x03,0x03},
+	{0x86,0xC6,0xE6,0xB6,0x95,0x95,0x95,0xB5,0xC4,0xE4,0xD4,0xA4,0x74,0x44,0x14,0x03,0x03,0x03,0x03,0x03,0x03},
+	{0xB6,0xE6,0x96,0x66,0x45,0x35,0x35,0x54,0x74,0x94,0xB4,0xE4,0xC4,0x94,0x53,0x23,0x03,0x03,0x03,0x03,0x03},
+	{0xD7,0xB6,0x66,0x16,0x05,0x05,0x05,0x04,0x14,0x34,0x64,0x94,0xD4,0xE3,0xA3,0x63,0x23,0x03,0x03,0x03,0x03},
+	{0xF7,0x97,0x47,0x07,0x06,0x05,0x05,0x04,0x04,0x04,0x14,0x44,0x83,0xB3,0xF3,0xB3,0x73,0x23,0x03,0x03,0x03},
+	{0xF7,0x97,0x37,0x07,0x07,0x05,0x05,0x04,0x04,0x04,0x04,0x04,0x33,0x73,0xB3,0xF3,0xB3,0x63,0x23,0x03,0x03},
+	{0xF7,0x97,0x37,0x07,0x07,0x07,0x04,0x04,0x04,0x04,0x04,0x03,0x03,0x23,0x73,0xB3,0xF3,0xA3,0x53,0x12,0x02},
+	{0xE7,0xB7,0x58,0x08,0x08,0x08,0x08,0x08,0x04,0x04,0x03,0x03,0x03,0x03,0x23,0x73,0xB3,0xE3,0x92,0x42,0x02},
+	{0xC8,0xC8,0x78,0x18,0x08,0x08,0x08,0x08,0x04,0x03,0x03,0x03,0x03,0x03,0x03,0x33,0x83,0xD2,0xC2,0x72,0x22},
+	{0xA8,0xE8,0x98,0x38,0x08,0x08,0x08,0x08,0x09,0x03,0x03,0x03,0x03,0x03,0x03,0x02,0x42,0x92,0xE2,0xA2,0x52},
+	{0x88,0xD8,0xB8,0x68,0x18,0x08,0x08,0x09,0x09,0x09,0x03,0x03,0x03,0x03,0x02,0x02,0x12,0x62,0xB2,0xD2,0x82},
+	{0x58,0xA8,0xE8,0x98,0x48,0x08,0x09,0x09,0x09,0x09,0x09,0x03,0x03,0x02,0x02,0x02,0x02,0x32,0x92,0xE2,0xA2},
+	{0x28,0x78,0xC8,0xD8,0x89,0x39,0x09,0x09,0x09,0x09,0x09,0x09,0x02,0x02,0x02,0x02,0x02,0x12,0x72,0xC2,0xC2},
+	{0x08,0x48,0x98,0xE9,0xB9,0x79,0x29,0x09,0x09,0x09,0x09,0x0A,0x0A,0x02,0x02,0x02,0x02,0x02,0x52,0xB1,0xE1},
+	{0x08,0x18,0x59,0xA9,0xF9,0xB9,0x79,0x29,0x09,0x09,0x0A,0x0A,0x0A,0x0A,0x02,0x01,0x01,0x01,0x31,0x91,0xF1},
+	{0x09,0x09,0x29,0x69,0xB9,0xF9,0xB9,0x79,0x39,0x0A,0x0A,0x0A,0x0A,0x0A,0x0B,0x01,0x01,0x01,0x31,0x91,0xF1},
+	{0x09,0x09,0x09,0x29,0x79,0xB9,0xF9,0xB9,0x89,0x4A,0x1A,0x0A,0x0A,0x0A,0x0B,0x0B,0x0C,0x01,0x41,0x91,0xF1},
+	{0x09,0x09,0x09,0x09,0x29,0x69,0xA9,0xE9,0xDA,0x9A,0x6A,0x3A,0x1A,0x0A,0x0B,0x0B,0x0B,0x1C,0x6C,0xBC,0xD1},
+	{0x09,0x09,0x09,0x09,0x09,0x29,0x59,0x9A,0xCA,0xEA,0xBA,0x9A,0x7A,0x5A,0x3B,0x3B,0x4B,0x6C,0x9C,0xEC,0xBC},
+	{0x09,0x09,0x09,0x09,0x09,0x09,0x1A,0x4A,0x7A,0xAA,0xDA,0xEA,0xCA,0xBB,0x9B,0x9B,0x9B,0xBC,0xEC,0xCC,0x8C},
+	{0x09,0x09,0x09,0x09,0x09,0x09,0x0A,0x0A,0x2A,0x5A,0x8A,0xAA,0xCA,0xEB,0xFB,0xFB,0xFB,0xDB,0xBC,0x8C,0x4C},
+};
+
+#if DIRDETECT_SRP
+static const INT16 s_ai16SrpLags[DIRTABLE_SRP_ANGLES][2] = {
+	{69,69}, {66,73}, {61,75}, {57,77}, {51,79}, {46,80},
+	{40,80}, {34,80}, {27,79}, {21,77}, {14,75}, {7,73},
+	{0,69}, {-7,66}, {-14,61}, {-21,57}, {-27,51}, {-34,46},
+	{-40,40}, {-46,34}, {-51,27}, {-57,21}, {-61,14}, {-66,7},
+	{-69,0}, {-73,-7}, {-75,-14}, {-77,-21}, {-79,-27}, {-80,-34},
+	{-80,-40}, {-80,-46}, {-79,-51}, {-77,-57}, {-75,-61}, {-73,-66},
+	{-69,-69}, {-66,-73}, {-61,-75}, {-57,-77}, {-51,-79}, {-46,-80},
+	{-40,-80}, {-34,-80}, {-27,-79}, {-21,-77}, {-14,-75}, {-7,-73},
+	{0,-69}, {7,-66}, {14,-61}, {21,-57}, {27,-51}, {34,-46},
+	{40,-40}, {46,-34}, {51,-27}, {57,-21}, {61,-14}, {66,-7},
+	{69,0}, {73,7}, {75,14}, {77,21}, {79,27}, {80,34},
+	{80,40}, {80,46}, {79,51}, {77,57}, {75,61}, {73,66},
+};
+#endif
+
+#else
+#error "DirTable.h has no table for this SAMPLE_FREQUENCY, run gen_dirtable.py"
+#endif
+
+#endif // __DIRTABLE_H
@@ -0,0 +1,348 @@
+#include "Platform.h"
+#include "GccPhat.h"
+
+// Generalized cross correlation with phase transform (GCC-PHAT).
+//
+// Each channel is transformed with a fixed point radix-2 FFT and every bin
+// is scaled to unit magnitude, so only phase is left.  The cross spectrum of
+// two whitened channels is then transformed back and its peak gives the lag.
+// Because every bin carries the same weight, loud low frequency noise can't
+// swamp the correlation the way it does in the time domain.
+//
+// Two real signals share one complex FFT wherever possible, so a decision
+// costs four GCCPHAT_FFT_SIZE point FFTs (AB input, C input, AB/AC output,
+// BC output).
+
+#if DIRDETECT_GCCPHAT
+
+//
+// Local Variables and Defines
+//
+
+#define N					GCCPHAT_FFT_SIZE
+#define HALF_N				(GCCPHAT_FFT_SIZE/2)
+#define NUM_BINS			(HALF_N + 1)
+
+// The largest FFT s_ai16SinTable covers, and how far apart the entries
+// GCCPHAT_FFT_SIZE uses are.
+#define TABLE_N				256
+#define TABLE_STEP			(TABLE_N/N)
+
+#if (GCCPHAT_FFT_SIZE > TABLE_N)
+#error "Regenerate s_ai16SinTable for the new GCCPHAT_FFT_SIZE"
+#endif
+
+#if (GCCPHAT_MAX_BIN > HALF_N)
+#error "GCCPHAT_MAX_HZ is above the Nyquist frequency"
+#endif
+
+// Channel spectra are scaled to this magnitude by the phase transform (Q14).
+#define UNIT_SHIFT			14
+
+// Quarter wave of sin(2*pi*k/TABLE_N) in Q15, k = 0 .. TABLE_N/4.
+static const INT16 s_ai16SinTable[TABLE_N/4 + 1] =
+{
+	0, 804, 1608, 2411, 3212, 4011, 4808, 5602,
+	6393, 7180, 7962, 8740, 9512, 10279, 11039, 11793,
+	12540, 13279, 14010, 14733, 15447, 16151, 16846, 17531,
+	18205, 18868, 19520, 20160, 20788, 21403, 22006, 22595,
+	23170, 23732, 24279, 24812, 25330, 25833, 26320, 26791,
+	27246, 27684, 28106, 28511, 28899, 29269, 29622, 29957,
+	30274, 30572, 30853, 31114, 31357, 31581, 31786, 31972,
+	32138, 32286, 32413, 32522, 32610, 32679, 32729, 32758,
+	32767,
+};
+
+// 2^28 / m for a magnitude m normalised to [2^14, 2^15), indexed by the 4 bits
+// below the leading one.
+static const UINT16 s_au16Reciprocal[16] =
+{
+	15888, 14980, 14170, 13443, 12788, 12193, 11651, 11155,
+	10700, 10280, 9892, 9533, 9198, 8886, 8595, 8322,
+};
+
+// FFT work buffer.
+static INT16 s_ai16Re[N];
+static INT16 s_ai16Im[N];
+
+// Whitened half spectra (bins 0 .. N/2) of channels A, B and C.
+static INT16 s_ai16SpecRe[3][NUM_BINS];
+static INT16 s_ai16SpecIm[3][NUM_BINS];
+
+// Analysis window (Q15).  Without it a loud hum leaks from its own bin into
+// the whole pass band and PHAT, which weights every bin equally, locks onto
+// it.
+static INT16 s_ai16Window[ADC_BUFFER_SIZE];
+static BOOL s_bWindowReady = FALSE;
+
+//
+// Local Functions
+//
+
+// cos and sin(2*pi*k/N), k = 0 .. N/2.
+static INT32 twiddle_cos(int k)
+{
+	return (k <= N/4) ? s_ai16SinTable[(N/4 - k)*TABLE_STEP] : -s_ai16SinTable[(k - N/4)*TABLE_STEP];
+}
+
+static INT32 twiddle_sin(int k)
+{
+	return (k <= N/4) ? s_ai16SinTable[k*TABLE_STEP] : s_ai16SinTable[(HALF_N - k)*TABLE_STEP];
+}
+
+// In place radix-2 decimation in time FFT of the work buffer.  Every stage
+// halves its output, so the result is the DFT divided by N and can't
+// overflow as long as the input magnitudes stay below 2^14.
+static void fft(void)
+{
+	int i, j, k, size, half, step;
+
+	// Bit reverse reorder.
+	for(i = 1, j = 0; i<N; i++) {
+		int bit = HALF_N;
+		while (j & bit) {
+			j ^= bit;
+			bit >>= 1;
+		}
+		j |= bit;
+		if (i < j) {
+			INT16 t;
+			t = s_ai16Re[i]; s_ai16Re[i] = s_ai16Re[j]; s_ai16Re[j] = t;
+			t = s_ai16Im[i]; s_ai16Im[i] = s_ai16Im[j]; s_ai16Im[j] = t;
+		}
+	}
+
+	for(size = 2, step = HALF_N; size<=N; size <<= 1, step >>= 1) {
+		half = size >> 1;
+		for(j = 0; j<half; j++) {
+			INT32 wr = twiddle_cos(j*step);
+			INT32 ws = twiddle_sin(j*step);
+			for(i = j; i<N; i += size) {
+				k = i + half;
+				{
+					// t = (wr - j*ws) * x[k]
+					INT32 tr = (wr*s_ai16Re[k] + ws*s_ai16Im[k]) >> 15;
+					INT32 ti = (wr*s_ai16Im[k] - ws*s_ai16Re[k]) >> 15;
+					INT32 ar = s_ai16Re[i];
+					INT32 ai = s_ai16Im[i];
+
+					s_ai16Re[i] = (INT16) ((ar + tr) >> 1);
+					s_ai16Im[i] = (INT16) ((ai + ti) >> 1);
+					s_ai16Re[k] = (INT16) ((ar - tr) >> 1);
+					s_ai16Im[k] = (INT16) ((ai - ti) >> 1);
+				}
+			}
+		}
+	}
+}
+
+// Scale one bin to unit magnitude (Q14) without a divide or square root.
+// The magnitude is estimated as max + 3/8 min (within 7%), normalised to
+// [2^14, 2^15) by shifting and inverted through a 16 entry table.
+static void whiten(INT32 re, INT32 im, INT16 *pi16Re, INT16 *pi16Im)
+{
+	INT32 absRe = (re < 0) ? -re : re;
+	INT32 absIm = (im < 0) ? -im : im;
+	INT32 mag, recip;
+	int shift = 0;
+
+	mag = (absRe > absIm) ? (absRe + ((absIm*3) >> 3)) : (absIm + ((absRe*3) >> 3));
+	if (mag == 0) {
+		*pi16Re = 0;
+		*pi16Im = 0;
+		return;
+	}
+
+	while (mag < 0x4000) {
+		mag <<= 1;
+		shift++;
+	}
+	while (mag >= 0x8000) {
+		mag >>= 1;
+		shift--;
+	}
+	recip = s_au16Reciprocal[(mag >> 10) & 0x0F];
+
+	if (shift >= 0) {
+		re <<= shift;
+		im <<= shift;
+	} else {
+		re >>= -shift;
+		im >>= -shift;
+	}
+	*pi16Re = (INT16) ((re*recip) >> (28 - UNIT_SHIFT));
+	*pi16Im = (INT16) ((im*recip) >> (28 - UNIT_SHIFT));
+}
+
+// Whiten bins 0 .. N/2 of the work buffer into a channel spectrum.  When two
+// real signals x + j*y were transformed together, 'split' selects which one to
+// extract: X[k] = (Z[k] + conj(Z[N-k]))/2, Y[k] = (Z[k] - conj(Z[N-k]))/2j.
+typedef enum { eSPLIT_NONE, eSPLIT_REAL, eSPLIT_IMAG } E_SPLIT;
+
+static void store_spectrum(int channel, E_SPLIT eSplit)
+{
+	int k;
+
+	for(k = 0; k<NUM_BINS; k++) {
+		INT32 re, im;
+
+		if ((k < GCCPHAT_MIN_BIN) || (k > GCCPHAT_MAX_BIN)) {
+			s_ai16SpecRe[channel][k] = 0;
+			s_ai16SpecIm[channel][k] = 0;
+			continue;
+		}
+
+		if (eSplit == eSPLIT_NONE) {
+			re = s_ai16Re[k];
+			im = s_ai16Im[k];
+		} else {
+			int m = (N - k) & (N - 1);
+			if (eSplit == eSPLIT_REAL) {
+				re = s_ai16Re[k] + s_ai16Re[m];
+				im = s_ai16Im[k] - s_ai16Im[m];
+			} else {
+				re = s_ai16Im[k] + s_ai16Im[m];
+				im = s_ai16Re[m] - s_ai16Re[k];
+			}
+		}
+		// The missing /2 doesn't matter, whiten() removes the scale.
+		whiten(re, im, &s_ai16SpecRe[channel][k], &s_ai16SpecIm[channel][k]);
+	}
+}
+
+// Build the (1 - x^2)^2 window once.  It tapers smoothly to zero at both
+// ends, so its sidelobes fall off as fast as a Hann window's, and it needs
+// no trig.  The divisions only run on the first call.
+static void init_window(void)
+{
+	int i;
+	INT32 half = ADC_BUFFER_SIZE - 1;
+
+	for(i = 0; i<ADC_BUFFER_SIZE; i++) {
+		INT32 x = 2*i - half;
+		INT32 w = 32767 - (INT32) (((INT64) x*x*32767)/((INT64) half*half));
+		s_ai16Window[i] = (INT16) ((w*w) >> 15);
+	}
+	s_bWindowReady = TRUE;
+}
+
+// Load one or two real signals into the work buffer, shifted by 'shift',
+// windowed and zero padded to N.
+static void load_signals(const INT16 *pi16X, const INT16 *pi16Y, int shift)
+{
+	int i;
+
+	for(i = 0; i<N; i++) {
+		INT32 x = 0, y = 0;
+
+		if (i < ADC_BUFFER_SIZE) {
+			x = pi16X[i];
+			if (pi16Y)
+				y = pi16Y[i];
+			x = (shift >= 0) ? (x << shift) : (x >> -shift);
+			y = (shift >= 0) ? (y << shift) : (y >> -shift);
+			x = (x*s_ai16Window[i]) >> 15;
+			y = (y*s_ai16Window[i]) >> 15;
+		}
+		s_ai16Re[i] = (INT16) x;
+		s_ai16Im[i] = (INT16) y;
+	}
+}
+
+// Cross spectrum bin X[k] * conj(Y[k]) of two whitened channels (Q12, so the
+// sum of two bins stays below the 2^14 FFT input limit).
+static void cross_bin(int x, int y, int k, INT32 *pi32Re, INT32 *pi32Im)
+{
+	INT32 xr = s_ai16SpecRe[x][k], xi = s_ai16SpecIm[x][k];
+	INT32 yr = s_ai16SpecRe[y][k], yi = s_ai16SpecIm[y][k];
+
+	*pi32Re = (xr*yr + xi*yi) >> (2*UNIT_SHIFT - 12);
+	*pi32Im = (xi*yr - xr*yi) >> (2*UNIT_SHIFT - 12);
+}
+
+// Inverse transform the cross spectra of pairs (x1, y1) and, if x2 >= 0,
+// (x2, y2) in one FFT.  Both correlations are real, so the first comes out
+// in the real part and the second in the imaginary part.  The inverse is
+// done as conj(FFT(conj(W))), which with the scaled FFT is exactly the IDFT.
+static void inverse_cross(int x1, int y1, int x2, int y2)
+{
+	int k;
+
+	for(k = 0; k<NUM_BINS; k++) {
+		INT32 g1r, g1i, g2r = 0, g2i = 0;
+
+		cross_bin(x1, y1, k, &g1r, &g1i);
+		if (x2 >= 0)
+			cross_bin(x2, y2, k, &g2r, &g2i);
+
+		// W[k] = G1[k] + j*G2[k], stored conjugated.
+		s_ai16Re[k] = (INT16) (g1r - g2i);
+		s_ai16Im[k] = (INT16) -(g1i + g2r);
+
+		// Both correlations are real, so W[N-k] = conj(G1[k]) + j*conj(G2[k]).
+		if ((k > 0) && (k < HALF_N)) {
+			s_ai16Re[N - k] = (INT16) (g1r + g2i);
+			s_ai16Im[N - k] = (INT16) (g1i - g2r);
+		}
+	}
+	fft();
+}
+
+// Copy a correlation (sign = 1 for the real part, -1 for the negated
+// imaginary part of the work buffer) into a cost curve.
+static void store_cost(const INT16 *pi16Corr, INT32 i32Sign, INT32 *pi32Cost)
+{
+	int lag;
+
+	for(lag = -DIRDETECT_MAX_LAG; lag<=DIRDETECT_MAX_LAG; lag++)
+		pi32Cost[lag + DIRDETECT_MAX_LAG] = -i32Sign * pi16Corr[lag & (N - 1)];
+}
+
+//
+// Global Functions
+//
+
+void gccPhatCostCurves(const INT16 *pi16A, const INT16 *pi16B, const INT16 *pi16C,
+					   INT32 *pi32CostAB, INT32 *pi32CostAC, INT32 *pi32CostBC)
+{
+	int i, shift = 0;
+	INT32 peak = 1;
+
+	if (!s_bWindowReady)
+		init_window();
+
+	// Block scale the input so the loudest sample sits just below 2^13.
+	for(i = 0; i<ADC_BUFFER_SIZE; i++) {
+		INT32 a = pi16A[i], b = pi16B[i], c = pi16C[i];
+		if (a < 0) a = -a;
+		if (b < 0) b = -b;
+		if (c < 0) c = -c;
+		if (a > peak) peak = a;
+		if (b > peak) peak = b;
+		if (c > peak) peak = c;
+	}
+	while ((peak << shift) < 0x1000)
+		shift++;
+	while ((shift <= 0) && ((peak >> -shift) >= 0x2000))
+		shift--;
+
+	// A and B share one transform, C gets its own.
+	load_signals(pi16A, pi16B, shift);
+	fft();
+	store_spectrum(0, eSPLIT_REAL);
+	store_spectrum(1, eSPLIT_IMAG);
+
+	load_signals(pi16C, 0, shift);
+	fft();
+	store_spectrum(2, eSPLIT_NONE);
+
+	// AB comes out in the real part, AC in the (conjugated) imaginary part.
+	inverse_cross(0, 1, 0, 2);
+	store_cost(s_ai16Re, 1, pi32CostAB);
+	store_cost(s_ai16Im, -1, pi32CostAC);
+
+	inverse_cross(1, 2, -1, -1);
+	store_cost(s_ai16Re, 1, pi32CostBC);
+}
+
+#endif // DIRDETECT_GCCPHAT
@@ -0,0 +1,39 @@
+#ifndef __GCCPHAT_H
+#define __GCCPHAT_H
+
+#include "Platform.h"
+#include "DirDetect.h"
+
+//
+// Global Defines and Declarations
+//
+
+// The FFT is zero padded to at least twice the capture window so the
+// correlation is linear rather than circular: 128 points up to 64 samples,
+// 256 (twice the RAM) up to 128.  The twiddle table in GccPhat.c is
+// generated for 256 points and stepped through for 128.
+#define GCCPHAT_FFT_LOG2		((2*ADC_BUFFER_SIZE <= 128) ? 7 : 8)
+#define GCCPHAT_FFT_SIZE		(1 << GCCPHAT_FFT_LOG2)
+
+#if DIRDETECT_GCCPHAT && (GCCPHAT_FFT_SIZE < 2*ADC_BUFFER_SIZE)
+#error "ADC_BUFFER_SIZE is too long for GCC-PHAT's FFT, at most 128 samples"
+#endif
+
+// Only this band is used for the phase transform.  The lower edge keeps
+// motor and speaker rumble out; the upper edge drops bins that are mostly
+// noise for speech and claps.
+#define GCCPHAT_MIN_HZ			500
+#define GCCPHAT_MAX_HZ			6000
+#define GCCPHAT_MIN_BIN			((GCCPHAT_MIN_HZ*GCCPHAT_FFT_SIZE + SAMPLE_FREQUENCY - 1)/SAMPLE_FREQUENCY)
+#define GCCPHAT_MAX_BIN			((GCCPHAT_MAX_HZ*GCCPHAT_FFT_SIZE)/SAMPLE_FREQUENCY)
+
+//
+// Global Functions
+//
+
+// Fill the cost curves (indexed by lag + DIRDETECT_MAX_LAG, lowest cost is the best
+// lag) for the AB, AC and BC pairs from the PHAT weighted cross correlation.
+void gccPhatCostCurves(const INT16 *pi16A, const INT16 *pi16B, const INT16 *pi16C,
+					   INT32 *pi32CostAB, INT32 *pi32CostAC, INT32 *pi32CostBC);
+
+#endif // __GCCPHAT_H
@@ -0,0 +1,21 @@
+#ifndef __GLOBAL_H
+#define __GLOBAL_H
+
+#include "Platform.h"
+#include "cmsis_os.h"
+
+//
+// Global Defines
+//
+
+// What the shared modules in ../Shared/Nuvoton expect the project to
+// provide.  Only SpiFS.c (for the recorder, see Capture.h) is built here.
+
+//
+// Global Variables
+//
+
+// The SPI0 master bus to the serial flash, defined in Capture.c.
+extern osMutexId spiMasterMutex;
+
+#endif // __GLOBAL_H
@@ -1,7 +1,6 @@
 #include "Platform.h"
 #include "Debug.h"
 #include "Idle.h"
-#include "Led.h"
 
 // Initialize the idle resources.
 void idleInit(void)
@@ -14,5 +13,9 @@ void idleInit(void)
 // higher priority tasks are ready to run.
 void idleLoop(void)
 {
-	// Do nothing for now.
+	// Sleep until the next interrupt.  The ADC interrupt wakes the detector
+	// thread every hop and the GPIO interrupt serves the I2C master, so
+	// there is nothing to poll; while the room is quiet only the
+	// wake-on-sound comparators and the kernel tick get us out of here.
+	__WFI();
 }
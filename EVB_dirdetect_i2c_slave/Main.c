@@ -14,6 +14,9 @@
 #include "gpio_rw.h"
 #include "soft_i2c.h"
 #include "DirDetect.h"
+#include "SlaveRegs.h"
+#include "Capture.h"
+#include "Profile.h"
 
 int button1, button2, button3, button4;
 
@@ -62,10 +65,13 @@ void clkInit(void)
 void gpioInit(void) {
 	// Configure GPIO A special functions.
 	DrvSYS_EnableMultifunctionGpioa(
-//		DRVSYS_GPIOA_MF1_SPI0_1ST_CHIP_SEL_OUT |	// Master SPI select output serial flash
-//		DRVSYS_GPIOA_MF2_SPI0_CLOCK_OUT |					// Master SPI clock output
-//		DRVSYS_GPIOA_MF3_SPI0_DATA_IN |						// Master SPI data input
-//		DRVSYS_GPIOA_MF4_SPI0_DATA_OUT |			
+#if DIRDETECT_CAPTURE
+		// The recorder's serial flash.  LEDs 1 and 2 go dark.
+		DRVSYS_GPIOA_MF1_SPI0_1ST_CHIP_SEL_OUT |	// Master SPI select output serial flash
+		DRVSYS_GPIOA_MF2_SPI0_CLOCK_OUT |					// Master SPI clock output
+		DRVSYS_GPIOA_MF3_SPI0_DATA_IN |						// Master SPI data input
+		DRVSYS_GPIOA_MF4_SPI0_DATA_OUT |			
+#endif
 		DRVSYS_GPIOA_MF8_ADC_CHANNEL0_IN|  	// ADC input
 		DRVSYS_GPIOA_MF9_ADC_CHANNEL1_IN|  	// ADC input
 		DRVSYS_GPIOA_MF10_ADC_CHANNEL2_IN|  // ADC input
@@ -122,10 +128,16 @@ void priorityInit(void) {
 
 	// Set the ADC interrupt lower than SPI and GPIO.
 	NVIC_SetPriority(ADC_IRQn, 1);
+
+#if DIRDETECT_CAPTURE
+	// The recorder's page programs can wait on the samples.
+	NVIC_SetPriority(SPI0_IRQn, 2);
+#endif
 }
 
 
-// Main thread.
+// Main thread.  With DIRDETECT_RTX the kernel is already running (see
+// RTX_CM_lib.h) and this is a thread like the detector's.
 int main (void) {
 	int i, j;
 	PRINTD("easy printf\n");
@@ -138,11 +150,19 @@ int main (void) {
 		
 	i2c_init(I2C_SDA_PORT, I2C_SDA_MASK, I2C_SCK_PORT, I2C_SCK_MASK);
 	
-	// Initialize ADC and DirDetect event handler
-//	dirDetectInit();
+	// Initialize ADC and DirDetect event handler.  It returns, leaving the
+	// processing to its thread (or interrupt).
+	dirDetectInit();
+
+#if PROFILE
+	// Start the cycle profiler.  This has to come after dirDetectInit(),
+	// which borrows Timer2 for a delay.
+	profileInit();
+#endif
 
 	
-	// Blink to show we're alive.
-	while(1);
+	// Serve the I2C registers from here on.  The mic calibration blocks for
+	// a while, so the I2C slave only asks for it and it runs here too.
+	slaveRegsRun();
 }
 
@@ -0,0 +1,95 @@
+#include <string.h>
+#include "Platform.h"
+#include "Driver/DrvSYS.h"
+#include "Driver/DrvFMC.h"
+#include "MicCal.h"
+
+//
+// Local Variables and Defines
+//
+
+#define MICCAL_WORDS				(sizeof(S_MICCAL)/sizeof(UINT32))
+
+//
+// Local Functions
+//
+
+// Complement of the sum of every word but the check word itself, so an
+// all zero page doesn't pass either.
+static UINT32 record_check(const S_MICCAL *psCal)
+{
+	const UINT32 *pu32 = (const UINT32 *) psCal;
+	UINT32 u32Check = 0;
+	UINT32 i;
+
+	for(i = 0; i<MICCAL_WORDS - 1; i++)
+		u32Check += pu32[i];
+	return ~u32Check;
+}
+
+// The ISP controller sits behind the protected registers.
+static void isp_open(void)
+{
+	DrvSYS_UnlockKeyReg();
+	DrvFMC_Open();
+	DrvFMC_EnableIspControl_P(eDRVFMC_ERASE_TIME_20MS, eDRVFMC_PROGRAM_TIME_40US, FALSE);
+}
+
+static void isp_close(void)
+{
+	DrvFMC_DisableIspControl_P();
+	DrvFMC_Close();
+	DrvSYS_LockKeyReg();
+}
+
+//
+// Global Functions
+//
+
+void micCalSetNeutral(S_MICCAL *psCal)
+{
+	int i;
+
+	for(i = 0; i<NUM_CHANNELS; i++) {
+		psCal->ai16Offset[i] = 0;
+		psCal->au16Gain[i] = MICCAL_GAIN_ONE;
+	}
+	psCal->i16DelayAB = 0;
+	psCal->i16DelayAC = 0;
+}
+
+BOOL micCalLoad(S_MICCAL *psCal)
+{
+	S_MICCAL sRecord;
+	ERRCODE eResult;
+
+	isp_open();
+	eResult = DrvFMC_ReadBuffer(MICCAL_FLASH_ADDR, (PUINT32) &sRecord, sizeof(sRecord));
+	isp_close();
+
+	// An erased page reads all ones, which fails both tests.
+	if ((eResult != E_SUCCESS) || (sRecord.u32Magic != MICCAL_MAGIC) || (sRecord.u32Check != record_check(&sRecord)))
+		return FALSE;
+
+	*psCal = sRecord;
+	return TRUE;
+}
+
+BOOL micCalSave(S_MICCAL *psCal)
+{
+	S_MICCAL sReadBack;
+	ERRCODE eResult;
+
+	psCal->u32Magic = MICCAL_MAGIC;
+	psCal->u32Check = record_check(psCal);
+
+	isp_open();
+	eResult = DrvFMC_ErasePage(MICCAL_FLASH_ADDR);
+	if (eResult == E_SUCCESS)
+		eResult = DrvFMC_WriteBuffer(MICCAL_FLASH_ADDR, (PUINT32) psCal, sizeof(*psCal));
+	if (eResult == E_SUCCESS)
+		eResult = DrvFMC_ReadBuffer(MICCAL_FLASH_ADDR, (PUINT32) &sReadBack, sizeof(sReadBack));
+	isp_close();
+
+	return (eResult == E_SUCCESS) && (memcmp(&sReadBack, psCal, sizeof(sReadBack)) == 0);
+}
@@ -0,0 +1,49 @@
+#ifndef __MICCAL_H
+#define __MICCAL_H
+
+#include "Platform.h"
+#include "DirDetect.h"
+
+//
+// Global Defines and Declarations
+//
+
+// Factory calibration of the microphones, kept in data flash so a warm boot
+// doesn't have to measure anything.  Keil links code into the first 64KB
+// of the 72KB flash (see RevB_Head_Keil.uvproj); the 8KB above that is data
+// flash and the record lives in its first 512 byte page.
+#define MICCAL_FLASH_ADDR			0x00010000
+#define MICCAL_PAGE_SIZE			512
+#define MICCAL_MAGIC				0x4D434132	// "MCA2", change when S_MICCAL (or what it means) changes
+
+#define MICCAL_GAIN_SHIFT			12			// gains are in fixed point with this many fractional bits
+#define MICCAL_GAIN_ONE				(1 << MICCAL_GAIN_SHIFT)
+
+typedef struct {
+	UINT32 u32Magic;							// MICCAL_MAGIC
+	UINT16 u16AdcOffsetSetting;					// ADC.PGCR.OS found by DrvADC_AnalysisAdcCalibration()
+	INT16 i16AdcAverage;						// the g_i16AveCalibrationValue it left, for the DAC
+	INT16 ai16Offset[NUM_CHANNELS];				// DC offset of each mic, subtracted from every sample
+	UINT16 au16Gain[NUM_CHANNELS];				// MICCAL_GAIN_ONE scaled gain that matches each mic to mic A
+	INT16 i16DelayAB;							// lags a source equally far from every mic shows once the scan
+	INT16 i16DelayAC;							// skew is out, in 1/DIRDETECT_LAG_ONE samples, subtracted from the phases
+	UINT32 u32Check;							// complement of the sum of the words above
+} S_MICCAL;
+
+//
+// Global Functions
+//
+
+// A record that changes nothing (no offset, unit gain, no delay).  The ADC
+// fields are left alone.
+void micCalSetNeutral(S_MICCAL *psCal);
+
+// Read the record from data flash.  Returns FALSE, leaving *psCal alone,
+// if there isn't a good one.
+BOOL micCalLoad(S_MICCAL *psCal);
+
+// Write *psCal to data flash (filling in the magic and check words) and
+// read it back.  Takes about 25ms with interrupts still running.
+BOOL micCalSave(S_MICCAL *psCal);
+
+#endif // __MICCAL_H
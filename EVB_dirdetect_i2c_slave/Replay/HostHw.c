@@ -0,0 +1,202 @@
+#include <string.h>
+
+#include "Driver/DrvGPIO.h"
+#include "Driver/DrvAPU.h"
+#include "Driver/DrvADC.h"
+
+#include "MicCal.h"
+#include "HostHw.h"
+
+//
+// Global Variables
+//
+GPIO_T GPIOA = { 0xFFFF };
+GPIO_T GPIOB = { 0xFFFF };
+ADC_T ADC;
+INT16 g_i16AveCalibrationValue = 0;
+
+//
+// Local Variables and Defines
+//
+
+// The handlers live in DirDetect.c.
+void ADC_IRQHandler(void);
+void USB_IRQHandler(void);
+
+static S_HOSTHW_STATS s_sStats;
+
+static BOOL s_abIrqEnabled[HOST_NUM_IRQn];
+static BOOL s_abIrqPending[HOST_NUM_IRQn];
+static BOOL s_bInIrq = FALSE;
+
+static BOOL s_bConverting = FALSE;
+static INT16 s_ai16Result[3];
+static BOOL s_bAdcFlag = FALSE;
+
+// One ADC result monitor (CMP0 or CMP1), on one of the scanned channels.
+typedef struct {
+	UINT8 u8Slot;			// scan slot of the channel it watches
+	BOOL bEnabled;
+	BOOL bIntEnabled;
+	BOOL bFlag;
+	E_DRVADC_CMP_COND eCond;
+	INT16 i16Data;
+	UINT8 u8MatchCount;
+	UINT8 u8Matches;
+} S_HOSTHW_CMP;
+
+static S_HOSTHW_CMP s_asCmp[2];
+
+//
+// Local Functions
+//
+
+// The channels are scanned in the order DirDetect.c sets, CH0CH1 first.
+static void enable_compare(S_HOSTHW_CMP *psCmp, UINT8 u8CmpChannelNum, E_DRVADC_CMP_COND eCmpCond, UINT16 u16CmpData, UINT8 u8CmpMatchCount)
+{
+	psCmp->u8Slot = (u8CmpChannelNum - eDRVADC_CH0CH1)/2;
+	psCmp->bEnabled = TRUE;
+	psCmp->eCond = eCmpCond;
+	psCmp->i16Data = (INT16) (u16CmpData << 4) >> 4;	// CMPD is 12 bit two's complement
+	psCmp->u8MatchCount = u8CmpMatchCount;
+	psCmp->u8Matches = 0;
+}
+
+static void run_compare(S_HOSTHW_CMP *psCmp)
+{
+	INT16 i16Result = s_ai16Result[psCmp->u8Slot];
+	BOOL bMatch;
+	
+	if (!psCmp->bEnabled)
+		return;
+	if (psCmp->eCond == eDRVADC_GREATER_OR_EQUAL)
+		bMatch = (i16Result >= psCmp->i16Data);
+	else
+		bMatch = (i16Result < psCmp->i16Data);
+	
+	if (!bMatch)
+		psCmp->u8Matches = 0;
+	else if (++psCmp->u8Matches >= psCmp->u8MatchCount) {
+		psCmp->u8Matches = 0;
+		psCmp->bFlag = TRUE;
+	}
+}
+
+static BOOL adc_irq_raised(void)
+{
+	return (ADC.ADCR.ADIE && s_bAdcFlag) ||
+		   (s_asCmp[0].bIntEnabled && s_asCmp[0].bFlag) ||
+		   (s_asCmp[1].bIntEnabled && s_asCmp[1].bFlag);
+}
+
+//
+// Global Functions
+//
+
+void hostHwSample(INT16 i16A, INT16 i16B, INT16 i16C)
+{
+	if (!s_bConverting)
+		return;
+	s_sStats.u32Samples++;
+	
+	s_ai16Result[0] = i16A;
+	s_ai16Result[1] = i16B;
+	s_ai16Result[2] = i16C;
+	s_bAdcFlag = TRUE;
+	run_compare(&s_asCmp[0]);
+	run_compare(&s_asCmp[1]);
+	
+	// The processing interrupt has the lower priority, so it only starts
+	// once the ADC interrupt is done.  It is assumed to finish before the
+	// next conversion; dirDetectGetOverruns() stays at zero on the host.
+	s_bInIrq = TRUE;
+	if (s_abIrqEnabled[ADC_IRQn] && adc_irq_raised()) {
+		s_sStats.u32AdcIrqs++;
+		ADC_IRQHandler();
+	}
+	if (s_abIrqEnabled[USB_IRQn] && s_abIrqPending[USB_IRQn]) {
+		s_abIrqPending[USB_IRQn] = FALSE;
+		s_sStats.u32ProcessIrqs++;
+		USB_IRQHandler();
+	}
+	s_bInIrq = FALSE;
+}
+
+const S_HOSTHW_STATS *hostHwGetStats(void)
+{
+	return &s_sStats;
+}
+
+// CMSIS core
+void NVIC_EnableIRQ(IRQn_Type IRQn)			{ s_abIrqEnabled[IRQn] = TRUE; }
+void NVIC_DisableIRQ(IRQn_Type IRQn)		{ s_abIrqEnabled[IRQn] = FALSE; }
+void NVIC_SetPendingIRQ(IRQn_Type IRQn)		{ s_abIrqPending[IRQn] = TRUE; }
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn)	{ s_abIrqPending[IRQn] = FALSE; }
+void NVIC_SetPriority(IRQn_Type IRQn, UINT32 priority) { }
+void __disable_irq(void) { }
+void __enable_irq(void) { }
+
+// GPIO
+void DrvGPIO_SetOutputBit(GPIO_T* pGPIO, UINT16 u16Pins)	{ pGPIO->DOUT |= u16Pins; }
+void DrvGPIO_ClearOutputBit(GPIO_T* pGPIO, UINT16 u16Pins)	{ pGPIO->DOUT &= ~(UINT32) u16Pins; }
+
+// APU and timer
+void DrvAPU_CalibrateDacDcWithAdcDc(void) { }
+void DrvTimer_WaitMillisecondTmr2(UINT32 u32Ms) { }
+
+// ADC setup
+void DrvADC_Open(void) { }
+void DrvADC_EnableAdc(void) { }
+void DrvADC_EnableRegulator(void) { }
+void DrvADC_SetRegulatorRC(E_DRVADC_REGULATOR_ACC_R eAccR, E_DRVADC_REGULATOR_WAKE_R eWakeR) { }
+void DrvADC_StartConvert(void)	{ s_bConverting = TRUE; }
+void DrvADC_StopConvert(void)	{ s_bConverting = FALSE; }
+void DrvADC_PreAmpGainControl(UINT32 u32Pag1, UINT32 u32Pag1Offset, UINT32 u32Pag2, BOOL bEnable) { }
+void DrvADC_SetAdcOperationMode(E_DRVADC_OPERATION_MODE eMode) { }
+void DrvADC_SetConversionDataFormat(E_DRVADC_CONVERSION_FORMAT eFormat) { }
+void DrvADC_SetConversionSequence(E_DRVADC_CHANNEL_NUM e0, E_DRVADC_CHANNEL_NUM e1, E_DRVADC_CHANNEL_NUM e2, E_DRVADC_CHANNEL_NUM e3,
+								  E_DRVADC_CHANNEL_NUM e4, E_DRVADC_CHANNEL_NUM e5, E_DRVADC_CHANNEL_NUM e6, E_DRVADC_CHANNEL_NUM e7) { }
+void DrvADC_AnalysisAdcCalibration(void) { }
+INT16 DrvADC_GetAveCalibrationValue(void) { return g_i16AveCalibrationValue; }
+
+// Data flash is blank, so the mics are used uncalibrated.
+BOOL micCalLoad(S_MICCAL *psCal)	{ return FALSE; }
+BOOL micCalSave(S_MICCAL *psCal)	{ return FALSE; }
+
+// ADC conversions.  Like the driver's, enabling and disabling the interrupt
+// also clears the flag and enables or disables the IRQ.
+void DrvADC_ClearAdcIntFlag(void)	{ s_bAdcFlag = FALSE; }
+void DrvADC_EnableAdcInt(void)		{ DrvADC_ClearAdcIntFlag(); ADC.ADCR.ADIE = 1; NVIC_EnableIRQ(ADC_IRQn); }
+void DrvADC_DisableAdcInt(void)		{ ADC.ADCR.ADIE = 0; DrvADC_ClearAdcIntFlag(); NVIC_DisableIRQ(ADC_IRQn); }
+INT16 DrvADC_GetConversionDataSigned(UINT8 u8ScanSeq) { return s_ai16Result[u8ScanSeq]; }
+
+BOOL DrvADC_GetAdcIntFlag(void)
+{
+	// Polled outside an interrupt (SkipAdcUnstableInput) the next
+	// conversion is always already done.
+	if (!s_bInIrq)
+		return TRUE;
+	return s_bAdcFlag;
+}
+
+// ADC result monitors
+void DrvADC_EnableCompare0(UINT8 u8CmpChannelNum, E_DRVADC_CMP_COND eCmpCond, UINT16 u16CmpData, UINT8 u8CmpMatchCount)
+{
+	enable_compare(&s_asCmp[0], u8CmpChannelNum, eCmpCond, u16CmpData, u8CmpMatchCount);
+}
+
+void DrvADC_EnableCompare1(UINT8 u8CmpChannelNum, E_DRVADC_CMP_COND eCmpCond, UINT16 u16CmpData, UINT8 u8CmpMatchCount)
+{
+	enable_compare(&s_asCmp[1], u8CmpChannelNum, eCmpCond, u16CmpData, u8CmpMatchCount);
+}
+
+void DrvADC_DisableCompare0(void)		{ s_asCmp[0].bEnabled = FALSE; }
+void DrvADC_DisableCompare1(void)		{ s_asCmp[1].bEnabled = FALSE; }
+void DrvADC_EnableCompare0Int(void)		{ s_asCmp[0].bIntEnabled = TRUE; }
+void DrvADC_EnableCompare1Int(void)		{ s_asCmp[1].bIntEnabled = TRUE; }
+void DrvADC_DisableCompare0Int(void)	{ s_asCmp[0].bIntEnabled = FALSE; }
+void DrvADC_DisableCompare1Int(void)	{ s_asCmp[1].bIntEnabled = FALSE; }
+BOOL DrvADC_GetCompare0IntFlag(void)	{ return s_asCmp[0].bFlag; }
+BOOL DrvADC_GetCompare1IntFlag(void)	{ return s_asCmp[1].bFlag; }
+void DrvADC_ClearCompare0IntFlag(void)	{ s_asCmp[0].bFlag = FALSE; }
+void DrvADC_ClearCompare1IntFlag(void)	{ s_asCmp[1].bFlag = FALSE; }
@@ -0,0 +1,28 @@
+#ifndef __HOSTHW_H
+#define __HOSTHW_H
+
+#include "Platform.h"
+
+//
+// Global Defines and Declarations
+//
+
+typedef struct {
+	UINT32 u32Samples;		// conversions fed in
+	UINT32 u32AdcIrqs;		// times ADC_IRQHandler ran
+	UINT32 u32ProcessIrqs;	// times the processing interrupt ran
+} S_HOSTHW_STATS;
+
+//
+// Global Functions
+//
+
+// One scan of the three microphones.  Runs ADC_IRQHandler if the sample
+// (or a comparator match on it) raises an enabled interrupt, then the
+// processing interrupt if that got pended.
+void hostHwSample(INT16 i16A, INT16 i16B, INT16 i16C);
+
+// Counters since the start of the run.
+const S_HOSTHW_STATS *hostHwGetStats(void);
+
+#endif // __HOSTHW_H
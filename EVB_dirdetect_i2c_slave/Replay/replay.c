@@ -0,0 +1,556 @@
+// Host replay harness for the direction detector.
+//
+// DirDetect.c is built unchanged against the stubs in stubs/ (it is
+// included below so its state can be read) and fed 3-channel WAV
+// recordings one scan at a time, the way the ADC interrupt sees them.
+// Recordings are resampled to ADC_SCAN_FREQUENCY, so one set of recordings
+// made at a high rate serves every configuration sweep.sh builds, and
+// DIRDETECT_OVERSAMPLE's decimator gets the noise a faster ADC would see.
+//
+//   replay [-e ssd|gccphat|srp] [-g gain] [-s reads] [-v] list.txt
+//
+// list.txt has one recording per line: the WAV file (relative to the list)
+// and the true angle of the source in degrees clockwise from LED 12, or '-'
+// for recordings with no source (every decision on those is a false one).
+// Channels 0, 1 and 2 are mics A, B and C.  Lines starting with '#' are
+// skipped.  synth.py writes synthetic recordings for a list, and
+// "make endfire" replays endfire.txt's with every engine.
+//
+// A list can also name the recorder's files (DDC1, see Capture.h) as they
+// come off the flash.  Their samples were taken scan by scan, so they
+// already have the scan skew and are only interpolated to
+// ADC_SCAN_FREQUENCY, not skewed again.  The calibration they were made
+// with is already out of them.  Dropped records replay as silence.  The
+// upsampling is linear, like a WAV's: a capture made at CAPTURE_DECIMATION
+// 2 or 4 has lost everything above SAMPLE_FREQUENCY/(2*CAPTURE_DECIMATION),
+// which interpolation doesn't bring back.  Its correlation peaks are wider
+// and its lags coarser than the board's own, so judge the lag resolution on
+// CAPTURE_DECIMATION 1 recordings.
+//
+// In DIRDETECT_AUDIO_STREAM builds, -s streams mic A throughout and reads
+// the packets back the way the I2C master does (see AudioStream.h), the
+// given number of times a second.  Each packet is checked, and the gaps in
+// the sequence numbers are counted against the drops the head reports.
+// "make stream" runs it.
+//
+// The last line printed starts with RESULT and is what sweep.sh collects.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "Platform.h"
+#include "HostHw.h"
+#include "DirDetect.h"
+
+// The table generated for the swept resolutions (see Makefile).  Including
+// it first makes DirDetect.c's own #include of DirTable.h a no-op.
+#include "DirTable.h"
+#include "../DirDetect.c"
+#include "AudioStream.h"
+#if DIRDETECT_AUDIO_STREAM
+#include "../../Shared/Nuvoton/Packet.h"
+#endif
+
+#if DIRDETECT_NUADCFILTER && (DIRDETECT_OVERSAMPLE > 1)
+#error "NuADCFilterEx only comes as a Keil library; replay DIRDETECT_OVERSAMPLE with the CIC"
+#endif
+
+//
+// Local Variables and Defines
+//
+
+#define REPLAY_MAX_LINE		512
+#define REPLAY_NO_LABEL		(-1)
+
+typedef struct {
+	UINT32 u32Rate;
+	UINT16 u16Channels;
+	UINT32 u32Frames;
+	INT16 *pi16Data;		// interleaved
+	BOOL bScanned;			// a capture, whose channels were taken in scan order rather than together
+} S_WAV;
+
+// __packed is empty on the host, so check the capture structs come out the
+// size Keil packs them to.
+typedef char REPLAY_CAPTURE_HEADER_SIZE[(sizeof(S_CAPTURE_HEADER) == 24 + sizeof(S_MICCAL)) ? 1 : -1];
+typedef char REPLAY_CAPTURE_RECORD_SIZE[(sizeof(S_CAPTURE_RECORD) == 6 + DIRDETECT_NUM_SOURCES) ? 1 : -1];
+
+typedef struct {
+	UINT32 u32Decisions;	// LEDs lit on labelled recordings
+	UINT32 u32Exact;		// ...in the right sector
+	UINT32 u32Adjacent;		// ...within one sector
+	UINT32 u32False;		// LEDs lit on recordings with no source
+	UINT32 u32Scans;		// scans fed in at ADC_SCAN_FREQUENCY
+	double dBearingError;	// sum of |dirDetectGetBearing() - angle| over the labelled decisions, degrees
+} S_REPLAY_SCORE;
+
+#if DIRDETECT_AUDIO_STREAM
+typedef struct {
+	UINT32 u32Packets;		// packets read
+	UINT32 u32Empty;		// reads that got no packet
+	UINT32 u32Bad;			// packets that aren't a good PACKET_TYPE_AUDIO one
+	UINT32 u32Missing;		// gaps in the sequence numbers
+	UINT32 u32Dropped;		// the head's count of drops when the last packet was read
+	UINT8 u8Sequence;		// the last packet's
+} S_REPLAY_STREAM;
+#endif
+
+static double s_dGain = 1.0;
+static BOOL s_bVerbose = FALSE;
+#if DIRDETECT_AUDIO_STREAM
+static double s_dStreamReads = 0;	// packets a second the master tries to read, 0 for no stream
+static double s_dStreamDue = 0;
+static S_REPLAY_STREAM s_sStream;
+#endif
+
+//
+// Local Functions
+//
+
+static UINT32 read_le(const UINT8 *pu8, int bytes)
+{
+	UINT32 u32 = 0;
+
+	while (bytes--)
+		u32 = (u32 << 8) | pu8[bytes];
+	return u32;
+}
+
+// Load a 16 bit PCM WAV file.  Returns FALSE (after saying why) if it
+// can't be used.
+static BOOL wav_read(const char *pszPath, S_WAV *psWav)
+{
+	FILE *f = fopen(pszPath, "rb");
+	UINT8 au8Header[12], au8Chunk[8], au8Fmt[16];
+	UINT16 u16Bits = 0;
+	BOOL bFmt = FALSE;
+
+	memset(psWav, 0, sizeof(*psWav));
+	if (!f) {
+		perror(pszPath);
+		return FALSE;
+	}
+	if ((fread(au8Header, 1, 12, f) != 12) || memcmp(au8Header, "RIFF", 4) || memcmp(au8Header + 8, "WAVE", 4)) {
+		fprintf(stderr, "%s: not a WAV file\n", pszPath);
+		fclose(f);
+		return FALSE;
+	}
+
+	while (fread(au8Chunk, 1, 8, f) == 8) {
+		UINT32 u32Size = read_le(au8Chunk + 4, 4);
+
+		if (!memcmp(au8Chunk, "fmt ", 4) && (u32Size >= 16)) {
+			if (fread(au8Fmt, 1, 16, f) != 16)
+				break;
+			psWav->u16Channels = read_le(au8Fmt + 2, 2);
+			psWav->u32Rate = read_le(au8Fmt + 4, 4);
+			u16Bits = read_le(au8Fmt + 14, 2);
+			bFmt = TRUE;
+			fseek(f, (u32Size - 16 + 1) & ~1, SEEK_CUR);
+		}
+		else if (!memcmp(au8Chunk, "data", 4) && bFmt) {
+			if ((u16Bits != 16) || (psWav->u16Channels < 3)) {
+				fprintf(stderr, "%s: need 16 bit samples and at least 3 channels\n", pszPath);
+				break;
+			}
+			psWav->u32Frames = u32Size/(2*psWav->u16Channels);
+			psWav->pi16Data = malloc(psWav->u32Frames*psWav->u16Channels*sizeof(INT16));
+			psWav->u32Frames = fread(psWav->pi16Data, 2*psWav->u16Channels, psWav->u32Frames, f);
+			fclose(f);
+			return TRUE;
+		}
+		else
+			fseek(f, (u32Size + 1) & ~1, SEEK_CUR);
+	}
+
+	if (!bFmt)
+		fprintf(stderr, "%s: no usable fmt/data chunks\n", pszPath);
+	fclose(f);
+	return FALSE;
+}
+
+// Load a recorder file into *psWav, one frame per sample it was recorded
+// at.  Returns FALSE (after saying why) if it can't be used.
+static BOOL capture_read(const char *pszPath, S_WAV *psWav)
+{
+	FILE *f = fopen(pszPath, "rb");
+	S_CAPTURE_HEADER sHeader;
+	S_CAPTURE_RECORD sRecord;
+	UINT32 u32Allocated = 0, u32Dropped = 0, u32First = 0, u32Frame;
+
+	memset(psWav, 0, sizeof(*psWav));
+	if (!f) {
+		perror(pszPath);
+		return FALSE;
+	}
+	if ((fread(&sHeader, sizeof(sHeader), 1, f) != 1) || (sHeader.u32Magic != CAPTURE_MAGIC) ||
+		(sHeader.u8Channels != NUM_CHANNELS) || !sHeader.u8Decimation || !sHeader.u32SampleRate) {
+		fprintf(stderr, "%s: not a capture this harness can read\n", pszPath);
+		fclose(f);
+		return FALSE;
+	}
+#if DIRDETECT_SCAN_SKEW_FIX
+	if ((sHeader.i16SkewAB != DIRDETECT_SKEW_AB) || (sHeader.i16SkewAC != DIRDETECT_SKEW_AC))
+		fprintf(stderr, "%s: recorded with a scan skew of %d/%d, not %d/%d\n", pszPath,
+				sHeader.i16SkewAB, sHeader.i16SkewAC, DIRDETECT_SKEW_AB, DIRDETECT_SKEW_AC);
+#endif
+	psWav->u32Rate = sHeader.u32SampleRate;
+	psWav->u16Channels = NUM_CHANNELS;
+	psWav->bScanned = TRUE;
+
+	// Records are placed by their first sample, counted from the first
+	// record's, so the gaps dropped records leave stay in.  Erased flash
+	// (all ones) or a record going backwards ends the recording.
+	while ((fread(&sRecord, sizeof(sRecord), 1, f) == 1) && (sRecord.u32Sample != 0xFFFFFFFF)) {
+		if (!u32Allocated)
+			u32First = sRecord.u32Sample;
+		u32Frame = (sRecord.u32Sample - u32First)/sHeader.u8Decimation;
+		if ((u32Frame < psWav->u32Frames) || (sRecord.u8Frames > DIRDETECT_RING_SIZE))
+			break;
+		if (u32Frame + sRecord.u8Frames > u32Allocated) {
+			UINT32 u32Old = u32Allocated;
+
+			u32Allocated = 2*(u32Frame + sRecord.u8Frames);
+			psWav->pi16Data = realloc(psWav->pi16Data, u32Allocated*NUM_CHANNELS*sizeof(INT16));
+			memset(psWav->pi16Data + u32Old*NUM_CHANNELS, 0, (u32Allocated - u32Old)*NUM_CHANNELS*sizeof(INT16));
+		}
+		if (fread(psWav->pi16Data + u32Frame*NUM_CHANNELS, NUM_CHANNELS*sizeof(INT16), sRecord.u8Frames, f) != sRecord.u8Frames)
+			break;
+		u32Dropped += sRecord.u8Dropped;
+		psWav->u32Frames = u32Frame + sRecord.u8Frames;
+	}
+	fclose(f);
+
+	if (!psWav->u32Frames) {
+		fprintf(stderr, "%s: no records\n", pszPath);
+		return FALSE;
+	}
+	if (u32Dropped)
+		fprintf(stderr, "%s: %u records were dropped while recording\n", pszPath, u32Dropped);
+	return TRUE;
+}
+
+// Load a WAV file or a capture, by what it starts with.
+static BOOL recording_read(const char *pszPath, S_WAV *psWav)
+{
+	FILE *f = fopen(pszPath, "rb");
+	UINT8 au8Magic[4];
+	BOOL bCapture;
+
+	if (!f) {
+		perror(pszPath);
+		return FALSE;
+	}
+	bCapture = (fread(au8Magic, 1, 4, f) == 4) && (read_le(au8Magic, 4) == CAPTURE_MAGIC);
+	fclose(f);
+	return bCapture ? capture_read(pszPath, psWav) : wav_read(pszPath, psWav);
+}
+
+// Channel ch of the recording when scan u32N converts it, linearly
+// interpolated and scaled by the gain.  Like the ADC, each channel of a WAV
+// is converted CYCLES_PER_CONVERSION clocks after the one before it
+// (channels 0, 1 and 2 being in DIRDETECT_SCAN_SLOT_A, B and C); a
+// capture's channels were already taken that way.
+static INT16 wav_sample(const S_WAV *psWav, UINT32 u32N, int ch)
+{
+	static const int aiSlot[NUM_CHANNELS] = { DIRDETECT_SCAN_SLOT_A, DIRDETECT_SCAN_SLOT_B, DIRDETECT_SCAN_SLOT_C };
+	int slot = psWav->bScanned ? 0 : aiSlot[ch];
+	double t = ((double) u32N/ADC_SCAN_FREQUENCY + (double) slot*CYCLES_PER_CONVERSION/ADC_CLOCK_FREQUENCY)*psWav->u32Rate;
+	UINT32 i = (UINT32) t;
+	double frac = t - i;
+	double x0, x1, x;
+
+	// The last scan's later channels can land past the end.
+	if (i >= psWav->u32Frames) {
+		i = psWav->u32Frames - 1;
+		frac = 0;
+	}
+	x0 = psWav->pi16Data[i*psWav->u16Channels + ch];
+	x1 = (i + 1 < psWav->u32Frames) ? psWav->pi16Data[(i + 1)*psWav->u16Channels + ch] : x0;
+	x = (x0 + (x1 - x0)*frac)*s_dGain;
+
+	if (x > 32767)
+		x = 32767;
+	else if (x < -32768)
+		x = -32768;
+	return (INT16) floor(x + 0.5);
+}
+
+// The LED number TurnOn_Light() was given, from the value it left in
+// direction.
+static int light_from_direction(INT32 i32Direction)
+{
+	return (i32Direction + 5) % 12 + 1;
+}
+
+static int sector_from_angle(double dDegrees)
+{
+	int sector = ((int) floor(dDegrees/30 + 0.5)) % 12;
+
+	if (sector < 0)
+		sector += 12;
+	return sector ? sector : 12;
+}
+
+#if DIRDETECT_AUDIO_STREAM
+// Read the stream as the master would, when a read is due.
+static void stream_read(void)
+{
+	PACKETData sPacket;
+	UINT8 u8Byte;
+
+	s_dStreamDue += s_dStreamReads/ADC_SCAN_FREQUENCY;
+	if (s_dStreamDue < 1)
+		return;
+	s_dStreamDue -= 1;
+
+	sPacket.length = audioStreamReadByte();
+	if (!sPacket.length) {
+		s_sStream.u32Empty++;
+		return;
+	}
+	sPacket.checksum = audioStreamReadByte();
+	for(u8Byte = 0; u8Byte<sPacket.length; u8Byte++)
+		sPacket.buffer[u8Byte] = audioStreamReadByte();
+
+	if ((sPacket.length != PACKET_BUF_LENGTH) || !packetValidateChecksum(&sPacket) ||
+		(packetGetDest(&sPacket) != PACKET_LOC_BTLE) || (packetGetSource(&sPacket) != PACKET_LOC_NVT2) ||
+		(packetGetType(&sPacket) != PACKET_TYPE_AUDIO) || (sPacket.buffer[PACKET_AUDIO_STEP_INDEX] > 88)) {
+		s_sStream.u32Bad++;
+		return;
+	}
+	if (s_sStream.u32Packets)
+		s_sStream.u32Missing += (UINT8) (sPacket.buffer[PACKET_AUDIO_SEQUENCE] - s_sStream.u8Sequence - 1);
+	s_sStream.u8Sequence = sPacket.buffer[PACKET_AUDIO_SEQUENCE];
+	s_sStream.u32Dropped = audioStreamGetDropped();
+	s_sStream.u32Packets++;
+}
+#endif
+
+// Feed one recording through the detector.
+static void replay_file(const char *pszPath, int label, S_REPLAY_SCORE *psScore)
+{
+	S_WAV sWav;
+	UINT32 u32N, u32Count;
+	UINT32 u32Decisions = 0, u32Exact = 0;
+
+	if (!recording_read(pszPath, &sWav))
+		exit(1);
+
+	// Every recording starts with a fresh capture, as after a reset.  The
+	// noise floor and the LED tracking carry over.
+	DrvADC_StopConvert();
+	start_ADC();
+	direction = 0;
+
+	u32Count = (UINT32) ((double) sWav.u32Frames*ADC_SCAN_FREQUENCY/sWav.u32Rate);
+	for(u32N = 0; u32N<u32Count; u32N++) {
+		hostHwSample(wav_sample(&sWav, u32N, 0), wav_sample(&sWav, u32N, 1), wav_sample(&sWav, u32N, 2));
+#if DIRDETECT_AUDIO_STREAM
+		if (s_dStreamReads > 0)
+			stream_read();
+#endif
+
+		if (direction) {
+			int light = light_from_direction(direction);
+
+			u32Decisions++;
+			if (label == REPLAY_NO_LABEL)
+				psScore->u32False++;
+			else {
+				int diff = abs(light - sector_from_angle(label)) % 12;
+
+				if (diff > 6)
+					diff = 12 - diff;
+				psScore->u32Decisions++;
+				if (diff == 0) {
+					psScore->u32Exact++;
+					u32Exact++;
+				}
+				if (diff <= 1)
+					psScore->u32Adjacent++;
+				psScore->dBearingError += fabs(remainder(dirDetectGetBearing(0)/10.0 - label, 360.0));
+			}
+			if (s_bVerbose)
+				printf("  %8.3fs LED %d confidence %d bearing %.1f, second source LED %d confidence %d\n", (double) u32N/ADC_SCAN_FREQUENCY,
+					   light, dirDetectGetConfidence(0), dirDetectGetBearing(0)/10.0, dirDetectGetDirection(1), dirDetectGetConfidence(1));
+			direction = 0;
+		}
+	}
+	psScore->u32Scans += u32Count;
+
+	if (label == REPLAY_NO_LABEL)
+		printf("%-40s    -  %5u decisions (false)\n", pszPath, u32Decisions);
+	else
+		printf("%-40s %4d  %5u decisions, %5u in sector %d\n", pszPath, label, u32Decisions, u32Exact, sector_from_angle(label));
+	free(sWav.pi16Data);
+}
+
+// Multiplies the current estimator does for one window.  A rough cost
+// figure for comparing configurations, not a cycle count.
+static UINT32 estimator_multiplies(void)
+{
+#if DIRDETECT_GCCPHAT
+	if (s_eEngine == eDIRDETECT_ENGINE_GCCPHAT) {
+		// windowing, two forward and two inverse FFTs at four multiplies a
+		// butterfly, and whitening plus three cross spectra per bin
+		return 3*ADC_BUFFER_SIZE
+			 + 4*4*(GCCPHAT_FFT_SIZE/2)*GCCPHAT_FFT_LOG2
+			 + 3*8*(GCCPHAT_FFT_SIZE/2 + 1);
+	}
+#endif
+	// energies, then one multiply per pair, lag tried and overlapping sample,
+	// and for SRP one per pair and direction scored to interpolate the costs
+	if (!dirDetectGetWindows())
+		return 0;
+	return 3*ADC_BUFFER_SIZE + (UINT32) (((double) dirDetectGetCostLags()*(ADC_BUFFER_SIZE - 2*DIRDETECT_MAX_LAG)
+#if DIRDETECT_SRP
+										  + 3.0*dirDetectGetSrpScores()
+#endif
+										  )/dirDetectGetWindows());
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: replay [-e ssd|gccphat|srp] [-c classes] [-g gain] [-s reads] [-v] list.txt\n");
+	fprintf(stderr, "  -c  the DIRDETECT_CLASS_BIT() mask of the classes estimated (1 speech, 2 transient, 4 noise)\n");
+	fprintf(stderr, "  -s  stream, reading packets back this many times a second (DIRDETECT_AUDIO_STREAM builds)\n");
+	exit(2);
+}
+
+//
+// Global Functions
+//
+
+int main(int argc, char *argv[])
+{
+	S_REPLAY_SCORE sScore;
+	const S_HOSTHW_STATS *psStats;
+	const char *pszList = NULL, *pszEngine = "ssd";
+	int classes = -1;
+	char szLine[REPLAY_MAX_LINE], szPath[REPLAY_MAX_LINE], szDir[REPLAY_MAX_LINE];
+	double dSeconds, dWindows;
+	FILE *f;
+	int i;
+
+	for(i = 1; i<argc; i++) {
+		if (!strcmp(argv[i], "-e") && (i + 1 < argc))
+			pszEngine = argv[++i];
+		else if (!strcmp(argv[i], "-c") && (i + 1 < argc))
+			classes = (int) strtol(argv[++i], NULL, 0);
+		else if (!strcmp(argv[i], "-g") && (i + 1 < argc))
+			s_dGain = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-s") && (i + 1 < argc)) {
+#if DIRDETECT_AUDIO_STREAM
+			s_dStreamReads = atof(argv[++i]);
+#else
+			fprintf(stderr, "-s needs DIRDETECT_AUDIO_STREAM\n");
+			return 2;
+#endif
+		}
+		else if (!strcmp(argv[i], "-v"))
+			s_bVerbose = TRUE;
+		else if ((argv[i][0] != '-') && !pszList)
+			pszList = argv[i];
+		else
+			usage();
+	}
+	if (!pszList)
+		usage();
+
+	dirDetectInit();
+	if (!strcmp(pszEngine, "ssd"))
+		dirDetectSetEngine(eDIRDETECT_ENGINE_SSD);
+	else if ((strcmp(pszEngine, "gccphat") || !dirDetectSetEngine(eDIRDETECT_ENGINE_GCCPHAT)) &&
+			 (strcmp(pszEngine, "srp") || !dirDetectSetEngine(eDIRDETECT_ENGINE_SRP))) {
+		fprintf(stderr, "engine %s isn't built in\n", pszEngine);
+		return 2;
+	}
+	if (classes >= 0) {
+#if DIRDETECT_CLASSIFY
+		dirDetectSetClassPolicy((UINT8) classes);
+#else
+		fprintf(stderr, "-c needs DIRDETECT_CLASSIFY\n");
+		return 2;
+#endif
+	}
+
+#if DIRDETECT_AUDIO_STREAM
+	if (s_dStreamReads > 0)
+		audioStreamStart();
+#endif
+
+	f = fopen(pszList, "r");
+	if (!f) {
+		perror(pszList);
+		return 1;
+	}
+	strcpy(szDir, pszList);
+	if (strrchr(szDir, '/'))
+		strrchr(szDir, '/')[1] = 0;
+	else
+		szDir[0] = 0;
+
+	printf("P_E_RES %d, %d STF waves (%d samples at %d Hz, scanned %dx), onset %d/8 of the floor/%d, confidence %d, %s\n",
+		   P_E_RES, NUM_STF_WAVES_PER_BUFFER, ADC_BUFFER_SIZE, SAMPLE_FREQUENCY, DIRDETECT_OVERSAMPLE,
+		   DIRDETECT_ONSET_GAIN, DIRDETECT_ONSET_MIN, DIRDETECT_MIN_CONFIDENCE, pszEngine);
+
+	memset(&sScore, 0, sizeof(sScore));
+	while (fgets(szLine, sizeof(szLine), f)) {
+		char szFile[REPLAY_MAX_LINE], szLabel[32];
+
+		if ((szLine[0] == '#') || (sscanf(szLine, "%s %31s", szFile, szLabel) != 2))
+			continue;
+		if (szFile[0] == '/')
+			strcpy(szPath, szFile);
+		else
+			snprintf(szPath, sizeof(szPath), "%s%s", szDir, szFile);
+		replay_file(szPath, strcmp(szLabel, "-") ? atoi(szLabel) : REPLAY_NO_LABEL, &sScore);
+	}
+	fclose(f);
+
+	psStats = hostHwGetStats();
+	dSeconds = (double) sScore.u32Scans/ADC_SCAN_FREQUENCY;
+	dWindows = dirDetectGetWindows();
+	if (dSeconds == 0) {
+		fprintf(stderr, "%s: nothing to replay\n", pszList);
+		return 1;
+	}
+
+	printf("%.1fs replayed: %u decisions, %.1f%% in the right sector, %.1f%% within one, %u false\n",
+		   dSeconds, sScore.u32Decisions,
+		   sScore.u32Decisions ? 100.0*sScore.u32Exact/sScore.u32Decisions : 0.0,
+		   sScore.u32Decisions ? 100.0*sScore.u32Adjacent/sScore.u32Decisions : 0.0,
+		   sScore.u32False);
+	printf("%.1f decisions/s, %.1f windows/s, %u multiplies/window, %.0f multiplies/s, %.0f ADC interrupts/s\n",
+		   (sScore.u32Decisions + sScore.u32False)/dSeconds, dWindows/dSeconds,
+		   estimator_multiplies(), dWindows*estimator_multiplies()/dSeconds,
+		   psStats->u32AdcIrqs/dSeconds);
+	printf("%.1f degrees mean bearing error\n", sScore.u32Decisions ? sScore.dBearingError/sScore.u32Decisions : 0.0);
+	printf("%u of %.0f windows rejected before the tracker\n", dirDetectGetRejected(), dWindows);
+#if DIRDETECT_CLASSIFY
+	printf("windows classed %u speech, %u transient, %u noise; estimating 0x%X\n",
+		   dirDetectGetClassWindows(eDIRDETECT_CLASS_SPEECH), dirDetectGetClassWindows(eDIRDETECT_CLASS_TRANSIENT),
+		   dirDetectGetClassWindows(eDIRDETECT_CLASS_NOISE), dirDetectGetClassPolicy());
+#endif
+#if DIRDETECT_COARSE_CHECK
+	printf("%u of %.0f windows missed the exhaustive SSD search's best lag\n", dirDetectGetCoarseMisses(), dWindows);
+#endif
+#if DIRDETECT_AUDIO_STREAM
+	if (s_dStreamReads > 0)
+		printf("stream %u packets read, %.1f/s, %u empty reads, %u bad, %u missing, %u dropped by the head\n",
+			   s_sStream.u32Packets, s_sStream.u32Packets/dSeconds, s_sStream.u32Empty, s_sStream.u32Bad,
+			   s_sStream.u32Missing, s_sStream.u32Dropped);
+#endif
+	printf("RESULT %d %d %d %d %s %.1f %.1f %u %.1f %.0f %.0f\n",
+		   P_E_RES, NUM_STF_WAVES_PER_BUFFER, DIRDETECT_ONSET_GAIN, DIRDETECT_MIN_CONFIDENCE, pszEngine,
+		   sScore.u32Decisions ? 100.0*sScore.u32Exact/sScore.u32Decisions : 0.0,
+		   sScore.u32Decisions ? 100.0*sScore.u32Adjacent/sScore.u32Decisions : 0.0,
+		   sScore.u32False,
+		   (sScore.u32Decisions + sScore.u32False)/dSeconds,
+		   dWindows*estimator_multiplies()/dSeconds,
+		   psStats->u32AdcIrqs/dSeconds);
+	return 0;
+}
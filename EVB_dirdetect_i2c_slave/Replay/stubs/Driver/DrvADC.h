@@ -0,0 +1,87 @@
+#ifndef __DRVADC_H__
+#define __DRVADC_H__
+
+// Host stand-in for the ADC driver.  Only what the direction detector calls
+// is here; HostHw.c models the conversion results, the interrupt flag and
+// the two result comparators.
+
+#include "Platform.h"
+
+typedef enum {
+	eDRVADC_CONTINUOUS_SCAN		= 3
+} E_DRVADC_OPERATION_MODE;
+
+typedef enum {
+	eDRVADC_2COMPLIMENT	= 1
+} E_DRVADC_CONVERSION_FORMAT;
+
+typedef enum {
+	eDRVADC_LESS_THAN			= 0,
+	eDRVADC_GREATER_OR_EQUAL	= 1
+} E_DRVADC_CMP_COND;
+
+typedef enum {
+	 eDRVADC_CH0CH1 = 0x8,
+	 eDRVADC_CH2CH3 = 0xA,
+	 eDRVADC_CH4CH5 = 0xC,
+	 eDRVADC_SCANEND = 0xF
+} E_DRVADC_CHANNEL_NUM;
+
+typedef enum {
+	eDRVADC_CTRS_R10K		= 0,
+	eDRVADC_CTRS_R600K		= 3
+} E_DRVADC_REGULATOR_ACC_R;
+
+typedef enum {
+	eDRVADC_FWU_R8K			= 0,
+	eDRVADC_FWU_R400K		= 3
+} E_DRVADC_REGULATOR_WAKE_R;
+
+#define DRVADC_PAG2_10DB 		1
+#define DRVADC_PAG1_29DB		9
+
+typedef struct {
+	struct {
+		UINT32 ADIE;
+	} ADCR;
+	struct {
+		UINT32 OS;
+	} PGCR;
+} ADC_T;
+
+extern ADC_T ADC;
+
+void DrvADC_Open(void);
+void DrvADC_EnableAdc(void);
+void DrvADC_EnableRegulator(void);
+void DrvADC_SetRegulatorRC(E_DRVADC_REGULATOR_ACC_R eAccR, E_DRVADC_REGULATOR_WAKE_R eWakeR);
+void DrvADC_StartConvert(void);
+void DrvADC_StopConvert(void);
+void DrvADC_PreAmpGainControl(UINT32 u32Pag1, UINT32 u32Pag1Offset, UINT32 u32Pag2, BOOL bEnable);
+void DrvADC_SetAdcOperationMode(E_DRVADC_OPERATION_MODE eMode);
+void DrvADC_SetConversionDataFormat(E_DRVADC_CONVERSION_FORMAT eFormat);
+void DrvADC_SetConversionSequence(E_DRVADC_CHANNEL_NUM e0, E_DRVADC_CHANNEL_NUM e1, E_DRVADC_CHANNEL_NUM e2, E_DRVADC_CHANNEL_NUM e3,
+								  E_DRVADC_CHANNEL_NUM e4, E_DRVADC_CHANNEL_NUM e5, E_DRVADC_CHANNEL_NUM e6, E_DRVADC_CHANNEL_NUM e7);
+void DrvADC_AnalysisAdcCalibration(void);
+INT16 DrvADC_GetAveCalibrationValue(void);
+
+void DrvADC_EnableAdcInt(void);
+void DrvADC_DisableAdcInt(void);
+BOOL DrvADC_GetAdcIntFlag(void);
+void DrvADC_ClearAdcIntFlag(void);
+INT16 DrvADC_GetConversionDataSigned(UINT8 u8ScanSeq);
+
+void DrvADC_EnableCompare0(UINT8 u8CmpChannelNum, E_DRVADC_CMP_COND eCmpCond, UINT16 u16CmpData, UINT8 u8CmpMatchCount);
+void DrvADC_EnableCompare1(UINT8 u8CmpChannelNum, E_DRVADC_CMP_COND eCmpCond, UINT16 u16CmpData, UINT8 u8CmpMatchCount);
+void DrvADC_DisableCompare0(void);
+void DrvADC_DisableCompare1(void);
+void DrvADC_EnableCompare0Int(void);
+void DrvADC_EnableCompare1Int(void);
+void DrvADC_DisableCompare0Int(void);
+void DrvADC_DisableCompare1Int(void);
+BOOL DrvADC_GetCompare0IntFlag(void);
+BOOL DrvADC_GetCompare1IntFlag(void);
+void DrvADC_ClearCompare0IntFlag(void);
+void DrvADC_ClearCompare1IntFlag(void);
+
+#endif
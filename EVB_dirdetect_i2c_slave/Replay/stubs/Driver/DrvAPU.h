@@ -0,0 +1,14 @@
+#ifndef __DRVAPU_H__
+#define __DRVAPU_H__
+
+// Host stand-in for the APU driver (and DrvTimer.h, which the real one
+// includes).
+
+#include "Platform.h"
+
+extern INT16 g_i16AveCalibrationValue;
+
+void DrvAPU_CalibrateDacDcWithAdcDc(void);
+void DrvTimer_WaitMillisecondTmr2(UINT32 u32Ms);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef __DRVGPIO_H__
+#define __DRVGPIO_H__
+
+// Host stand-in for the GPIO driver.  Output bits are kept in DOUT so the
+// harness can see the LEDs (active low, like the board).
+
+#include "Platform.h"
+
+typedef struct {
+	UINT32 DOUT;
+} GPIO_T;
+
+extern GPIO_T GPIOA;
+extern GPIO_T GPIOB;
+
+#define DRVGPIO_PIN_0		BIT0
+#define DRVGPIO_PIN_1		BIT1
+#define DRVGPIO_PIN_2		BIT2
+#define DRVGPIO_PIN_3		BIT3
+#define DRVGPIO_PIN_4		BIT4
+#define DRVGPIO_PIN_5		BIT5
+#define DRVGPIO_PIN_6		BIT6
+#define DRVGPIO_PIN_7		BIT7
+#define DRVGPIO_PIN_12		BIT12
+#define DRVGPIO_PIN_13		BIT13
+#define DRVGPIO_PIN_14		BIT14
+#define DRVGPIO_PIN_15		BIT15
+
+void DrvGPIO_SetOutputBit(GPIO_T* pGPIO, UINT16 u16Pins);
+void DrvGPIO_ClearOutputBit(GPIO_T* pGPIO, UINT16 u16Pins);
+
+#endif
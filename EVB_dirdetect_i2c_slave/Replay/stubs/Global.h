@@ -0,0 +1,10 @@
+#ifndef __GLOBAL_H
+#define __GLOBAL_H
+
+// Host stand-in for ../Global.h, for the shared headers that include it
+// (../../Shared/Nuvoton/Packet.h, for AudioStream.c).  There is no RTX
+// kernel here, so only the types.
+
+#include "Platform.h"
+
+#endif // __GLOBAL_H
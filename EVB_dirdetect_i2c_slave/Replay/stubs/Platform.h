@@ -0,0 +1,41 @@
+#ifndef __PLATFORM_H__
+#define __PLATFORM_H__
+
+// Host stand-in for Nuvoton/Include/Platform.h: the Nuvoton types plus the
+// few CMSIS core functions the direction detector uses.  Interrupts are
+// "taken" by HostHw.c calling the handlers directly.
+
+#include "NVTTypes.h"
+
+// armcc's qualifier for structs laid out as a file format.  The ones the
+// detector includes have no padding to remove.
+#define __packed
+
+#define BIT0	0x00000001
+#define BIT1	0x00000002
+#define BIT2	0x00000004
+#define BIT3	0x00000008
+#define BIT4	0x00000010
+#define BIT5	0x00000020
+#define BIT6	0x00000040
+#define BIT7	0x00000080
+#define BIT12	0x00001000
+#define BIT13	0x00002000
+#define BIT14	0x00004000
+#define BIT15	0x00008000
+
+typedef enum {
+	ADC_IRQn	= 2,
+	USB_IRQn	= 4,
+	HOST_NUM_IRQn = 32
+} IRQn_Type;
+
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+void NVIC_DisableIRQ(IRQn_Type IRQn);
+void NVIC_SetPendingIRQ(IRQn_Type IRQn);
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+void NVIC_SetPriority(IRQn_Type IRQn, UINT32 priority);
+void __disable_irq(void);
+void __enable_irq(void);
+
+#endif /* __PLATFORM_H__ */
@@ -0,0 +1,90 @@
+#!/bin/sh
+#
+# Build the replay harness for every combination of settings below, run it
+# on a list of recordings (see replay.c) and print accuracy against cost,
+# cheapest first.  The cheapest configuration that reaches the target
+# accuracy is marked with '*'.
+#
+#   ./sweep.sh [-t target%] [-e ssd|gccphat|srp] list.txt
+#
+# The swept values can be overridden from the environment, e.g.
+#
+#   RESOLUTIONS="7 9" WAVES="5 6 7" ./sweep.sh list.txt
+#
+# Configurations DirDetect.h or GccPhat.h reject (a window over 128 samples,
+# or too short for the lag search) are reported as skipped.
+
+RESOLUTIONS=${RESOLUTIONS:-"5 7 9 11"}
+WAVES=${WAVES:-"4 5 7"}
+ONSETS=${ONSETS:-"9 10 12"}	# eighths of the noise floor
+CONFIDENCES=${CONFIDENCES:-"4 6 8"}
+
+TARGET=90
+ENGINE=ssd
+while getopts "t:e:" opt; do
+	case $opt in
+		t) TARGET=$OPTARG ;;
+		e) ENGINE=$OPTARG ;;
+		*) exit 2 ;;
+	esac
+done
+shift $((OPTIND - 1))
+if [ $# -ne 1 ]; then
+	echo "usage: $0 [-t target%] [-e ssd|gccphat|srp] list.txt" >&2
+	exit 2
+fi
+LIST=$1
+
+cd "$(dirname "$0")" || exit 1
+case $LIST in
+	/*) ;;
+	*) LIST="$OLDPWD/$LIST" ;;
+esac
+
+if [ "$ENGINE" = gccphat ]; then
+	GCCPHAT=1
+else
+	GCCPHAT=0
+fi
+
+RESULTS=build/sweep/results.txt
+mkdir -p build/sweep
+: > $RESULTS
+
+for res in $RESOLUTIONS; do
+	for waves in $WAVES; do
+		for onset in $ONSETS; do
+			for conf in $CONFIDENCES; do
+				bin=build/sweep/replay_${res}_${waves}_${onset}_${conf}_${ENGINE}
+				defs="-DPHASE_ESTIMATION_RESOLUTION=$res -DNUM_STF_WAVES_PER_BUFFER=$waves \
+					  -DDIRDETECT_ONSET_GAIN=$onset -DDIRDETECT_MIN_CONFIDENCE=$conf -DDIRDETECT_GCCPHAT=$GCCPHAT"
+				if ! make -s BIN=$bin DEFS="$defs" > /dev/null 2>&1; then
+					echo "skipped P_E_RES=$res waves=$waves (doesn't build)" >&2
+					continue
+				fi
+				echo "running P_E_RES=$res waves=$waves onset=$onset confidence=$conf" >&2
+				./$bin -e $ENGINE "$LIST" | grep '^RESULT' >> $RESULTS
+			done
+		done
+	done
+done
+
+# RESULT res waves onset conf engine exact% adjacent% false decisions/s multiplies/s adc-irqs/s
+sort -k11,11n $RESULTS | awk -v target=$TARGET '
+	BEGIN {
+		printf("%-5s %-5s %-5s %-4s %-8s %7s %8s %6s %8s %12s %9s\n",
+			   "res", "waves", "onset", "conf", "engine", "exact%", "adjacent%", "false", "dec/s", "mults/s", "adc irq/s")
+	}
+	{
+		mark = " "
+		if (!found && $7 >= target) {
+			mark = "*"
+			found = 1
+		}
+		printf("%-5s %-5s %-5s %-4s %-8s %7s %8s %6s %8s %12s %9s %s\n",
+			   $2, $3, $4, $5, $6, $7, $8, $9, $10, $11, $12, mark)
+	}
+	END {
+		if (!found)
+			printf("nothing reached %s%% in the right sector\n", target)
+	}'
@@ -0,0 +1,103 @@
+#!/usr/bin/env python
+#
+# Writes the synthetic recordings a replay list names: six clicks from a far
+# away source at the list's angle, as mics A, B and C would hear them, with
+# a little noise.  The mic positions are read from DirDetect.h the same way
+# gen_dirtable.py does, so the recordings follow the board.
+#
+#     python synth.py endfire.txt
+#
+# Lines labelled '-' and recordings that already exist are left alone.
+# Only the standard library is used.
+
+import array
+import math
+import os
+import random
+import sys
+import wave
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.dirname(HERE))
+import gen_dirtable
+
+RATE = 192000				# well above any ADC_SCAN_FREQUENCY, replay resamples
+SECONDS = 4.0
+CLICKS = 6
+CLICK_START = 0.25			# seconds
+CLICK_PERIOD = 0.5
+CLICK_LENGTH = 0.02
+CLICK_DECAY = 400.0			# 1/s
+CLICK_TONES = 60			# the click is a sum of decaying tones 300..7300 Hz
+PEAK = 3000					# of the loudest click, LSBs
+NOISE = 27					# peak to peak, LSBs
+
+
+def click_tones(n):
+	rnd = random.Random(77*n + 1)
+	return [(300 + rnd.randrange(7000), rnd.uniform(0, 2*math.pi)) for _ in range(CLICK_TONES)]
+
+
+def synth(path, angle, d):
+	# A far away source in direction u reaches the mic at p (p.u)/c seconds
+	# before it reaches the centre of the board.
+	theta = math.radians(angle)
+	ux, uy = math.sin(theta), math.cos(theta)
+	lead = []
+	for m in "ABC":
+		px, py = gen_dirtable.mic_position(d, m)
+		lead.append((px*ux + py*uy)/d["SPEED_OF_SOUND"])
+
+	frames = int(RATE*SECONDS)
+	length = int(RATE*CLICK_LENGTH) + 2
+	chans = [[0.0]*frames for _ in lead]
+	for n in range(CLICKS):
+		tones = click_tones(n)
+		start = CLICK_START + n*CLICK_PERIOD
+		for ch, x in zip(chans, lead):
+			t0 = start - x
+			first = int(math.ceil(t0*RATE))
+			for i in range(first, first + length):
+				t = float(i)/RATE - t0
+				if t > CLICK_LENGTH:
+					break
+				v = sum(math.sin(2*math.pi*f*t + p) for f, p in tones)
+				ch[i] = v*math.exp(-t*CLICK_DECAY)
+
+	peak = max(max(abs(v) for v in ch) for ch in chans)
+	rnd = random.Random(5)
+	out = array.array("h")
+	for i in range(frames):
+		for ch in chans:
+			out.append(int(round(ch[i]*PEAK/peak + rnd.uniform(-0.5, 0.5)*NOISE)))
+	if sys.byteorder != "little":
+		out.byteswap()
+
+	w = wave.open(path, "wb")
+	w.setnchannels(len(chans))
+	w.setsampwidth(2)
+	w.setframerate(RATE)
+	w.writeframes(out.tobytes())
+	w.close()
+
+
+def main():
+	if len(sys.argv) != 2:
+		sys.exit("usage: synth.py list.txt")
+	listpath = sys.argv[1]
+	d = gen_dirtable.read_defines(gen_dirtable.HEADER_IN)
+	for line in open(listpath):
+		fields = line.split()
+		if not fields or fields[0].startswith("#") or len(fields) < 2 or fields[1] == "-":
+			continue
+		path = os.path.join(os.path.dirname(listpath), fields[0])
+		if os.path.exists(path):
+			continue
+		if not os.path.isdir(os.path.dirname(path)):
+			os.makedirs(os.path.dirname(path))
+		print("synth %s at %s degrees" % (path, fields[1]))
+		synth(path, float(fields[1]), d)
+
+
+if __name__ == "__main__":
+	main()
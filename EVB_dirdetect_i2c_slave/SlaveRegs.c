@@ -0,0 +1,129 @@
+#include "Platform.h"
+#include "DirDetect.h"
+#include "SlaveRegs.h"
+#include "Capture.h"
+
+//
+// Local Variables and Defines
+//
+
+#if DIRDETECT_RTX
+static osThreadId s_tidRegs = NULL;
+
+// The tracker's output as the master reads it, written only by
+// slaveRegsRun()'s thread: the I2C_REG_TRACK byte with the bearing above
+// it.  One word per source, so a read never sees half an update.
+static volatile UINT32 s_au32Track[DIRDETECT_NUM_SOURCES];
+#endif
+
+// The I2C_REG_BEARING reads, only touched by GPAB_IRQHandler.
+static UINT8 s_u8BearingSource = 0;
+static UINT8 s_u8BearingByte = 0;			// next byte of s_u32Bearing to read
+static UINT32 s_u32Bearing;
+
+//
+// Local Functions
+//
+
+// The I2C_REG_TRACK byte and bearing of source u8Source as the detector
+// has them now.
+static UINT32 current_track(UINT8 u8Source)
+{
+	return ((UINT32) dirDetectGetBearing(u8Source) << 8) |
+		   (dirDetectGetConfidence(u8Source) << 4) | dirDetectGetDirection(u8Source);
+}
+
+#if DIRDETECT_RTX
+static void refresh_track(void)
+{
+	UINT8 u8Source;
+
+	for(u8Source = 0; u8Source<DIRDETECT_NUM_SOURCES; u8Source++)
+		s_au32Track[u8Source] = current_track(u8Source);
+}
+#endif
+
+// The same as the master reads it.
+static UINT32 track_word(UINT8 u8Source)
+{
+#if DIRDETECT_RTX
+	return s_au32Track[u8Source];
+#else
+	return current_track(u8Source);
+#endif
+}
+
+//
+// Global Functions
+//
+
+void slaveRegsRun(void)
+{
+#if DIRDETECT_RTX
+	s_tidRegs = osThreadGetId();
+	dirDetectNotify(s_tidRegs, SLAVEREGS_SIGNAL_TRACK);
+#if DIRDETECT_CAPTURE
+	captureInit(s_tidRegs, SLAVEREGS_SIGNAL_CAPTURE);
+#endif
+	refresh_track();
+
+	for (;;)
+	{
+		osEvent evt = osSignalWait(0, osWaitForever);
+
+		if (evt.status != osEventSignal) continue;
+
+		// The calibration blocks for a while (all the LEDs stay on), and
+		// the track reads as it was until it is done.
+		if ((evt.value.signals & SLAVEREGS_SIGNAL_CALIBRATE) &&
+			(dirDetectGetCalibrationState() == eDIRDETECT_CAL_REQUESTED))
+			dirDetectCalibrate();
+#if DIRDETECT_CAPTURE
+		// So does opening and closing a recording's file.
+		if (evt.value.signals & SLAVEREGS_SIGNAL_CAPTURE)
+			captureService();
+#endif
+		refresh_track();
+	}
+#else
+	for (;;)
+	{
+		if (dirDetectGetCalibrationState() == eDIRDETECT_CAL_REQUESTED)
+			dirDetectCalibrate();
+	}
+#endif
+}
+
+UINT8 slaveRegsGetTrack(UINT8 u8Source)
+{
+	if (u8Source >= DIRDETECT_NUM_SOURCES)
+		return 0;
+	return (UINT8) track_word(u8Source);
+}
+
+void slaveRegsSelectBearing(UINT8 u8Source)
+{
+	s_u8BearingSource = (u8Source < DIRDETECT_NUM_SOURCES) ? u8Source : 0;
+	s_u8BearingByte = 0;
+}
+
+UINT8 slaveRegsGetBearingByte(void)
+{
+	UINT8 u8Byte;
+	
+	if (s_u8BearingByte == 0)
+		s_u32Bearing = track_word(s_u8BearingSource);
+	u8Byte = (UINT8) (s_u32Bearing >> (8*s_u8BearingByte));
+	if (++s_u8BearingByte >= 3)
+		s_u8BearingByte = 0;
+	return u8Byte;
+}
+
+void slaveRegsRequestCalibration(void)
+{
+	dirDetectRequestCalibration();
+#if DIRDETECT_RTX
+	if (s_tidRegs)
+		osSignalSet(s_tidRegs, SLAVEREGS_SIGNAL_CALIBRATE);
+#endif
+}
@@ -0,0 +1,46 @@
+#ifndef __SLAVEREGS_H
+#define __SLAVEREGS_H
+
+#include "Platform.h"
+
+//
+// Global Defines and Declarations
+//
+
+// What the I2C slave serves (see I2C_REG_* in soft_i2c.h) and the
+// requests it takes.  With DIRDETECT_RTX this belongs to the thread that
+// runs slaveRegsRun(): the detector thread tells it when the tracker's
+// output changes and it copies that into the bytes GPAB_IRQHandler reads,
+// and the calibration a master asks for runs there too, as does the
+// recorder's flash work (DIRDETECT_CAPTURE), so nothing the interrupt does
+// waits on the detector.
+#define SLAVEREGS_SIGNAL_TRACK		0x01	// the tracker's output changed
+#define SLAVEREGS_SIGNAL_CALIBRATE	0x02	// a master selected I2C_REG_CALIBRATE
+#define SLAVEREGS_SIGNAL_CAPTURE	0x04	// captureService() has something to do
+
+//
+// Global Functions
+//
+
+// Serve the registers from the calling thread (main() after
+// dirDetectInit()).  Never returns.  Without DIRDETECT_RTX this is the main
+// loop and only waits for calibration requests.
+void slaveRegsRun(void);
+
+// For GPAB_IRQHandler.  The I2C_REG_TRACK/I2C_REG_TRACK2 byte of source
+// u8Source: the LED in the low nibble and its confidence in the high one.
+UINT8 slaveRegsGetTrack(UINT8 u8Source);
+
+// For GPAB_IRQHandler.  The reads of I2C_REG_BEARING/I2C_REG_BEARING2
+// for source u8Source: slaveRegsSelectBearing() when it is selected, then
+// each read takes the next byte of its I2C_REG_TRACK byte and
+// dirDetectGetBearing(), low byte first.  The three bytes are from the
+// same update, taken when the first is read, and the fourth read starts
+// again with a new one.
+void slaveRegsSelectBearing(UINT8 u8Source);
+UINT8 slaveRegsGetBearingByte(void);
+
+// For GPAB_IRQHandler.  Ask for dirDetectCalibrate() to be run.
+void slaveRegsRequestCalibration(void);
+
+#endif // __SLAVEREGS_H
@@ -0,0 +1,82 @@
+#include <string.h>
+#include "Platform.h"
+#include "VendorJudge.h"
+
+#if DIRDETECT_VENDOR
+
+// Only this file sees the library's header (see VendorJudge.h).
+#include "Audio/DirDetect.h"
+
+#if (ADC_BUFFER_SIZE != VENDOR_JUDGE_SAMPLES)
+#error "VENDOR_JUDGE_SAMPLES doesn't match the library's ADC_BUFFER_SIZE"
+#endif
+
+//
+// Local Variables and Defines
+//
+
+#define VENDOR_JUDGE_MICS			3
+
+// Decimated history, a ring of VENDOR_JUDGE_SAMPLES per mic.  The library
+// gets a straight copy, as it doesn't say whether it writes to its input.
+static INT16 s_aai16History[VENDOR_JUDGE_MICS][VENDOR_JUDGE_SAMPLES];
+static INT16 s_aai16Pcm[VENDOR_JUDGE_MICS][VENDOR_JUDGE_SAMPLES];
+static UINT16 s_u16Write = 0;				// next history slot, and the oldest sample
+
+// The decimator's running sums.
+static INT32 s_ai32Sum[VENDOR_JUDGE_MICS];
+static UINT8 s_u8Summed = 0;
+
+//
+// Global Functions
+//
+
+void vendorJudgeReset(void)
+{
+	memset(s_aai16History, 0, sizeof(s_aai16History));
+	memset(s_ai32Sum, 0, sizeof(s_ai32Sum));
+	s_u8Summed = 0;
+	s_u16Write = 0;
+}
+
+void vendorJudgePush(const INT16 * const *ppi16Ring, UINT32 u32From, UINT32 u32To, UINT32 u32Mask)
+{
+	UINT32 u32Sample;
+	UINT8 u8Mic;
+
+	for(u32Sample = u32From; u32Sample != u32To; u32Sample++) {
+		for(u8Mic = 0; u8Mic<VENDOR_JUDGE_MICS; u8Mic++)
+			s_ai32Sum[u8Mic] += ppi16Ring[u8Mic][u32Sample & u32Mask];
+		if (++s_u8Summed < VENDOR_JUDGE_DECIMATION)
+			continue;
+
+		// Box filter: a third is 21845/65536, near enough.
+		for(u8Mic = 0; u8Mic<VENDOR_JUDGE_MICS; u8Mic++) {
+			s_aai16History[u8Mic][s_u16Write] = (INT16) ((s_ai32Sum[u8Mic]*21845) >> 16);
+			s_ai32Sum[u8Mic] = 0;
+		}
+		s_u8Summed = 0;
+		if (++s_u16Write >= VENDOR_JUDGE_SAMPLES)
+			s_u16Write = 0;
+	}
+}
+
+INT32 vendorJudgeRun(void)
+{
+	UINT16 u16Older = VENDOR_JUDGE_SAMPLES - s_u16Write;
+	UINT8 u8Mic;
+
+	// Oldest first: the slots from s_u16Write on, then the ones before it.
+	for(u8Mic = 0; u8Mic<VENDOR_JUDGE_MICS; u8Mic++) {
+		memcpy(&s_aai16Pcm[u8Mic][0], &s_aai16History[u8Mic][s_u16Write], u16Older*sizeof(INT16));
+		memcpy(&s_aai16Pcm[u8Mic][u16Older], &s_aai16History[u8Mic][0], s_u16Write*sizeof(INT16));
+	}
+	return DirDetect_Judge(s_aai16Pcm[0], s_aai16Pcm[1], s_aai16Pcm[2]);
+}
+
+UINT32 vendorJudgeGetVersion(void)
+{
+	return DirDetect_GetVersion();
+}
+
+#endif // DIRDETECT_VENDOR
@@ -0,0 +1,46 @@
+#ifndef __VENDORJUDGE_H
+#define __VENDORJUDGE_H
+
+#include "Platform.h"
+
+//
+// Global Defines and Declarations
+//
+
+// Wrapper around Nuvoton's direction detector, DirDetect_Judge() in
+// Audio/DirDetect.h.  That header defines SAMPLE_FREQUENCY, ADC_BUFFER_SIZE
+// and friends for its own 16kHz capture, so only VendorJudge.c includes it
+// and nothing here may depend on it.  The library itself is in
+// SDK_F072_Keil.lib, which isn't part of this tree.  RevB_Head_Keil.uvproj
+// lists it under Lib Files as ..\Nuvoton\Lib\SDK_F072_Keil.lib, left out
+// of the build; put the library there and include it in the build (both
+// targets) before turning this on.
+#ifndef DIRDETECT_VENDOR
+#define DIRDETECT_VENDOR 0 // build the DirDetect_Judge() estimator (about 1.7KB of RAM plus the library's own)
+#endif
+
+#define VENDOR_JUDGE_DECIMATION		3		// DirDetect_Judge() wants 16kHz; SAMPLE_FREQUENCY/3 is 15.7kHz at P_E_RES 9
+#define VENDOR_JUDGE_SAMPLES		138		// its ADC_BUFFER_SIZE (CORRELATION_SIZE + 2*CORR_SHIFT_MAX), checked in VendorJudge.c
+
+//
+// Global Functions
+//
+
+// Forget the history, e.g. after the capture restarts.
+void vendorJudgeReset(void);
+
+// Decimate the samples u32From..u32To-1 of the capture rings (one per mic,
+// indexed with u32Mask) into the library's history.
+void vendorJudgePush(const INT16 * const *ppi16Ring, UINT32 u32From, UINT32 u32To, UINT32 u32Mask);
+
+// Run DirDetect_Judge() on the newest VENDOR_JUDGE_SAMPLES of history and
+// return what it does.  History from before the last reset reads as silence.
+// The library's header doesn't say what the result means.  DirDetect.c
+// takes 1..12 as the LED in our numbering and anything else as no answer,
+// but that is unverified: it hasn't been run against the library, and
+// DIRDETECT_BENCHMARK's agreement figure is the way to check it.
+INT32 vendorJudgeRun(void);
+
+UINT32 vendorJudgeGetVersion(void);
+
+#endif // __VENDORJUDGE_H
@@ -0,0 +1,206 @@
+#!/usr/bin/env python
+#
+# Generates DirTable.h, the (lagAB, lagAC) -> LED sector lookup used by
+# determineDirection() in DirDetect.c, the lags of the angles the SRP
+# estimator steers to, and the matrix that turns lags back into a bearing.
+#
+# The mic spacing, speed of sound, mic positions and every
+# PHASE_ESTIMATION_RESOLUTION are read from DirDetect.h, so after changing
+# any of them just run
+#
+#     python gen_dirtable.py
+#
+# from this directory.  DirTable.h checks at compile time that it matches
+# DirDetect.h and stops the build with an #error if it doesn't.
+#
+# The host replay harness (Replay/) writes its own copy with tables for the
+# extra resolutions it sweeps:
+#
+#     python gen_dirtable.py -o out.h 5 7 9 11
+#
+
+import argparse
+import math
+import os
+import re
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+HEADER_IN = os.path.join(HERE, "DirDetect.h")
+HEADER_OUT = os.path.join(HERE, "DirTable.h")
+
+STEPS_PER_SAMPLE = 2		# table resolution, must match DIRTABLE_STEP_SHIFT
+NUM_SECTORS = 12			# one per LED, LED 12 points "up"
+CONFIDENCE_MAX = 15
+CONFIDENCE_ZERO = 0.25		# distance from a real direction (in units of P_E_RES samples) that gets no confidence
+ANGLE_STEPS = 3600			# search grid for the nearest direction
+SRP_ANGLES = 72				# directions the SRP estimator tries, 5 degrees apart
+BEARING_FRAC_BITS = 8		# of the lag to vector matrix
+
+
+def read_defines(path):
+	text = open(path).read()
+	defines = {}
+	for name in ("SPEED_OF_SOUND", "DISTANCE_BETWEEN_MICS", "DIRDETECT_LAG_FRAC_BITS",
+				 "DIRDETECT_MIC_A_DEG", "DIRDETECT_MIC_B_DEG", "DIRDETECT_MIC_C_DEG"):
+		m = re.search(r"^#define\s+%s\s+(\d+)" % name, text, re.M)
+		if not m:
+			sys.exit("%s: can't find %s" % (path, name))
+		defines[name] = int(m.group(1))
+	res = [int(r) for r in re.findall(r"^#define\s+PHASE_ESTIMATION_RESOLUTION\s+(\d+)", text, re.M)]
+	if not res:
+		sys.exit("%s: can't find PHASE_ESTIMATION_RESOLUTION" % path)
+	defines["resolutions"] = sorted(set(res), reverse=True)
+	return defines
+
+
+def sample_frequency(d, res):
+	# Same integer arithmetic as SOUND_TRAVEL_FREQUENCY and SAMPLE_FREQUENCY
+	stf = d["SPEED_OF_SOUND"] // d["DISTANCE_BETWEEN_MICS"] + 1
+	return stf * res
+
+
+def mic_position(d, name):
+	# Mics sit on a circle through the corners of an equilateral triangle,
+	# angles are clockwise from LED 12
+	radius = d["DISTANCE_BETWEEN_MICS"] / math.sqrt(3.0)
+	a = math.radians(d["DIRDETECT_MIC_%s_DEG" % name])
+	return (radius*math.sin(a), radius*math.cos(a))
+
+
+def source_lags(d, res, theta):
+	# A positive lagXY means the sound reached Y first.  For a far away
+	# source in direction u, lagXY = fs/c * (pY - pX).u samples.
+	k = float(sample_frequency(d, res)) / d["SPEED_OF_SOUND"]
+	pa, pb, pc = [mic_position(d, m) for m in "ABC"]
+	ux, uy = math.sin(theta), math.cos(theta)
+	lag_ab = k*((pb[0] - pa[0])*ux + (pb[1] - pa[1])*uy)
+	lag_ac = k*((pc[0] - pa[0])*ux + (pc[1] - pa[1])*uy)
+	return lag_ab, lag_ac
+
+
+def build_table(d, res):
+	curve = []
+	for i in range(ANGLE_STEPS):
+		theta = 2*math.pi*i/ANGLE_STEPS
+		lag_ab, lag_ac = source_lags(d, res, theta)
+		curve.append((lag_ab, lag_ac, theta))
+
+	half = STEPS_PER_SAMPLE*res
+	rows = []
+	for iab in range(-half, half + 1):
+		row = []
+		for iac in range(-half, half + 1):
+			ab = float(iab)/STEPS_PER_SAMPLE
+			ac = float(iac)/STEPS_PER_SAMPLE
+			dist, theta = min((math.hypot(ab - x, ac - y), t) for x, y, t in curve)
+			conf = int(round(CONFIDENCE_MAX*(1.0 - dist/(CONFIDENCE_ZERO*res))))
+			conf = max(0, min(CONFIDENCE_MAX, conf))
+			sector = int(round(theta*NUM_SECTORS/(2*math.pi))) % NUM_SECTORS
+			if sector == 0:
+				sector = NUM_SECTORS
+			row.append((conf << 4) | sector)
+		rows.append(row)
+	return rows
+
+
+def build_bearing(d):
+	# lag = fs/c * D.u, where the rows of D are pB - pA and pC - pA, so
+	# DISTANCE_BETWEEN_MICS * D^-1 takes the lags to u, scaled to the lag of
+	# a source in line with two mics whatever the sample rate.
+	pa, pb, pc = [mic_position(d, m) for m in "ABC"]
+	ab = (pb[0] - pa[0], pb[1] - pa[1])
+	ac = (pc[0] - pa[0], pc[1] - pa[1])
+	det = ab[0]*ac[1] - ab[1]*ac[0]
+	scale = d["DISTANCE_BETWEEN_MICS"]*(1 << BEARING_FRAC_BITS)/det
+	return [int(round(scale*v)) for v in (ac[1], -ab[1], -ac[0], ab[0])]
+
+
+def build_srp(d, res):
+	# (lagAB, lagAC) of each SRP angle in 1/DIRDETECT_LAG_ONE samples.
+	one = 1 << d["DIRDETECT_LAG_FRAC_BITS"]
+	lags = []
+	for i in range(SRP_ANGLES):
+		lag_ab, lag_ac = source_lags(d, res, 2*math.pi*i/SRP_ANGLES)
+		lags.append((int(round(one*lag_ab)), int(round(one*lag_ac))))
+	return lags
+
+
+def main():
+	parser = argparse.ArgumentParser(description="Generate DirTable.h from DirDetect.h")
+	parser.add_argument("-o", dest="output", default=HEADER_OUT, help="output file (default DirTable.h)")
+	parser.add_argument("resolutions", nargs="*", type=int, help="PHASE_ESTIMATION_RESOLUTIONs to add")
+	args = parser.parse_args()
+
+	d = read_defines(HEADER_IN)
+	d["resolutions"] = sorted(set(d["resolutions"] + args.resolutions), reverse=True)
+	out = []
+	w = out.append
+	w("// Generated by gen_dirtable.py from DirDetect.h, don't edit.")
+	w("//")
+	w("// s_au8DirTable[lagAB][lagAC] holds the LED (1..12) a far away source with")
+	w("// those lags would light in the low nibble, and in the high nibble how close")
+	w("// the lag pair is to one a real source can produce (0..15).  Lags are in")
+	w("// 1/%d samples and offset by DIRTABLE_HALF." % STEPS_PER_SAMPLE)
+	w("//")
+	w("// s_ai16SrpLags[n] holds the lagAB and lagAC, in 1/DIRDETECT_LAG_ONE samples,")
+	w("// of a far away source n*360/DIRTABLE_SRP_ANGLES degrees clockwise from")
+	w("// LED 12.")
+	w("//")
+	w("// DIRTABLE_BEARING_X(ab, ac) and DIRTABLE_BEARING_Y(ab, ac) turn the lags of a")
+	w("// far away source back into its direction, east and north of LED 12, as long")
+	w("// as the lag of a source in line with two mics.")
+	w("")
+	w("#ifndef __DIRTABLE_H")
+	w("#define __DIRTABLE_H")
+	w("")
+	w("#if (SPEED_OF_SOUND != %d) || (DISTANCE_BETWEEN_MICS != %d) || \\" %
+	  (d["SPEED_OF_SOUND"], d["DISTANCE_BETWEEN_MICS"]))
+	w("    (DIRDETECT_MIC_A_DEG != %d) || (DIRDETECT_MIC_B_DEG != %d) || (DIRDETECT_MIC_C_DEG != %d) || \\" %
+	  (d["DIRDETECT_MIC_A_DEG"], d["DIRDETECT_MIC_B_DEG"], d["DIRDETECT_MIC_C_DEG"]))
+	w("    (DIRDETECT_LAG_FRAC_BITS != %d)" % d["DIRDETECT_LAG_FRAC_BITS"])
+	w("#error \"DirTable.h is out of date, run gen_dirtable.py\"")
+	w("#endif")
+	w("")
+	w("#define DIRTABLE_STEP_SHIFT\t\t(DIRDETECT_LAG_FRAC_BITS - %d)" % int(math.log(STEPS_PER_SAMPLE, 2)))
+	w("#define DIRTABLE_SECTOR(x)\t\t((x) & 0x0F)")
+	w("#define DIRTABLE_CONFIDENCE(x)\t((x) >> 4)")
+	w("#define DIRTABLE_SRP_ANGLES\t\t%d" % SRP_ANGLES)
+	m = build_bearing(d)
+	w("#define DIRTABLE_BEARING_X(ab, ac)\t(((ab)*%d + (ac)*%d) >> %d)" % (m[0], m[1], BEARING_FRAC_BITS))
+	w("#define DIRTABLE_BEARING_Y(ab, ac)\t(((ab)*%d + (ac)*%d) >> %d)" % (m[2], m[3], BEARING_FRAC_BITS))
+	w("")
+	for n, res in enumerate(d["resolutions"]):
+		rows = build_table(d, res)
+		half = STEPS_PER_SAMPLE*res
+		w("#%s (SAMPLE_FREQUENCY == %d)" % ("if" if n == 0 else "elif", sample_frequency(d, res)))
+		w("")
+		w("#define DIRTABLE_HALF\t\t\t%d" % half)
+		w("#define DIRTABLE_SIZE\t\t\t(2*DIRTABLE_HALF + 1)")
+		w("")
+		w("static const UINT8 s_au8DirTable[DIRTABLE_SIZE][DIRTABLE_SIZE] = {")
+		for row in rows:
+			w("\t{" + ",".join("0x%02X" % v for v in row) + "},")
+		w("};")
+		w("")
+		w("#if DIRDETECT_SRP")
+		w("static const INT16 s_ai16SrpLags[DIRTABLE_SRP_ANGLES][2] = {")
+		lags = build_srp(d, res)
+		for i in range(0, SRP_ANGLES, 6):
+			w("\t" + " ".join("{%d,%d}," % l for l in lags[i:i + 6]))
+		w("};")
+		w("#endif")
+		w("")
+	w("#else")
+	w("#error \"DirTable.h has no table for this SAMPLE_FREQUENCY, run gen_dirtable.py\"")
+	w("#endif")
+	w("")
+	w("#endif // __DIRTABLE_H")
+
+	f = open(args.output, "w")
+	f.write("\n".join(out) + "\n")
+	f.close()
+
+
+if __name__ == "__main__":
+	main()
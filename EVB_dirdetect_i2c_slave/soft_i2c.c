@@ -1,4 +1,9 @@
 #include "soft_i2c.h"
+#include "DirDetect.h"
+#include "SlaveRegs.h"
+#include "Capture.h"
+#include "AudioStream.h"
+#include "Profile.h"
 
 // Implements software-based I2C communication protocol.
 
@@ -23,7 +28,8 @@ static SoftI2C i2c = {
 	HIGH,		// sck_pin
 	HIGH,		// sda_pin
 	NO_STATE,	// state
-	0x0d			// direction_register
+	0x0d,			// direction_register
+	I2C_REG_DIRECTION	// reg
 };
 
 //**********************************************************************//
@@ -446,6 +452,95 @@ slave_i2c_get_byte(void) {
     return byte;
 }
 
+// The master wrote a register number.
+static void i2c_select_register(uint8_t reg) {
+	i2c.reg = reg;
+#if PROFILE
+	if(reg == I2C_REG_PROFILE) {
+		profileDumpStart();
+	} else if(reg == I2C_REG_PROFILE_RESET) {
+		profileReset();
+#if DIRDETECT_BENCHMARK
+		dirDetectResetBenchmark();
+#endif
+	}
+#endif
+	if(reg == I2C_REG_BEARING) {
+		slaveRegsSelectBearing(0);
+	} else if(reg == I2C_REG_BEARING2) {
+		slaveRegsSelectBearing(1);
+	} else if(reg == I2C_REG_CALIBRATE) {
+		slaveRegsRequestCalibration();
+	}
+#if DIRDETECT_CAPTURE
+	if(reg == I2C_REG_CAPTURE) {
+		captureRequest(eCAPTURE_TRIGGER_ONSET);
+	} else if(reg == I2C_REG_CAPTURE_NOW) {
+		captureRequest(eCAPTURE_TRIGGER_COMMAND);
+	} else if(reg == I2C_REG_CAPTURE_STOP) {
+		captureRequestStop();
+	}
+#endif
+#if DIRDETECT_AUDIO_STREAM
+	if(reg == I2C_REG_STREAM) {
+		audioStreamStart();
+	} else if(reg == I2C_REG_STREAM_STOP) {
+		audioStreamStop();
+	}
+#endif
+#if DIRDETECT_CLASSIFY
+	if((reg & ~DIRDETECT_CLASS_ALL) == I2C_REG_CLASS_POLICY) {
+		dirDetectSetClassPolicy(reg & DIRDETECT_CLASS_ALL);
+	}
+#endif
+}
+
+// The byte to send for a master read of the selected register.
+static uint8_t i2c_read_register(void) {
+#if DIRDETECT_CLASSIFY
+	if((i2c.reg & ~DIRDETECT_CLASS_ALL) == I2C_REG_CLASS_POLICY)
+		return dirDetectGetClassPolicy();
+#endif
+	switch(i2c.reg) {
+#if PROFILE
+		case I2C_REG_PROFILE:
+			return profileDumpByte();
+#endif
+		case I2C_REG_TRACK:
+			return slaveRegsGetTrack(0);
+		case I2C_REG_TRACK2:
+			return slaveRegsGetTrack(1);
+		case I2C_REG_BEARING:
+		case I2C_REG_BEARING2:
+			return slaveRegsGetBearingByte();
+		case I2C_REG_CALIBRATE:
+			return dirDetectGetCalibrationState();
+#if DIRDETECT_BENCHMARK
+		case I2C_REG_AGREEMENT:
+			return dirDetectGetAgreement();
+#endif
+#if DIRDETECT_CAPTURE
+		case I2C_REG_CAPTURE:
+		case I2C_REG_CAPTURE_NOW:
+		case I2C_REG_CAPTURE_STOP:
+			return captureGetState();
+#endif
+#if DIRDETECT_AUDIO_STREAM
+		case I2C_REG_STREAM:
+			return audioStreamReadByte();
+		case I2C_REG_STREAM_STOP:
+			return (uint8_t) audioStreamGetDropped();
+#endif
+#if DIRDETECT_CLASSIFY
+		case I2C_REG_CLASS:
+			return dirDetectGetClass();
+#endif
+		case I2C_REG_DIRECTION:
+		default:
+			return slaveRegsGetTrack(0);
+	}
+}
+
 //**********************************************************************//
 //							Public Functions							//
 //**********************************************************************//
@@ -453,8 +548,10 @@ slave_i2c_get_byte(void) {
 // Handle the GPIO interrupt. Print a message and clear the int flags.
 void GPAB_IRQHandler(void) {
 	uint16_t int_flags = DrvGPIO_GetIntFlag(I2C_SCK_PORT, 0xFFFF);
+	UINT32 u32Profile;
 	
-	DrvADC_DisableAdcInt();				// Disable ADC interrupt
+	PROFILE_START(u32Profile);
+	dirDetectPause();					// Disable ADC interrupt
 	
 	// Did interrupt fire from a clock transition?
 	if(int_flags & I2C_SCK_MASK) {
@@ -493,6 +590,7 @@ void GPAB_IRQHandler(void) {
 			}
 		}
 	}
+	PROFILE_END(ePROFILE_GPAB_IRQ, u32Profile);
 }
 
 
@@ -505,7 +603,7 @@ bool i2c_update_slave_state(transition_t transition) {
 		switch(i2c.state) {
 			case NO_STATE:
 				i2c_data_high();
-				DrvADC_EnableAdcInt();				//enable ADC interrupt
+				dirDetectResume();					//enable ADC interrupt
 				break;
 			// Should we read in the address?
 			case ADDRESS:
@@ -518,6 +616,10 @@ bool i2c_update_slave_state(transition_t transition) {
 					if((i2c.sda_pin == HIGH) && (i2c.address == 0x0d)) {
 						i2c.data_state = WRITE;
 						i2c.state = SEND_ADDRESS_ACK;
+					} else if(i2c.address == 0x0d) {
+						// Master write: one byte selects the register to read.
+						i2c.data_state = READ;
+						i2c.state = SEND_ADDRESS_ACK;
 					} else {
 						i2c_data_high();
 						i2c.state = NO_STATE;
@@ -602,6 +704,9 @@ bool i2c_update_slave_state(transition_t transition) {
 		}
 		else if(i2c.state == DATA_ACK_SENT) {
 			i2c_data_high();
+			if(i2c.data_state == READ) {
+				i2c_select_register(i2c.data);
+			}
 			i2c.state = NO_STATE;
 			i2c.bit = 0;
 			PRINTD("%x %x\n", i2c.address, i2c.data);
@@ -609,8 +714,9 @@ bool i2c_update_slave_state(transition_t transition) {
 		} else if(i2c.state == DATA) {
 			if(i2c.data_state == WRITE) {
 				if(i2c.bit <= 7) {
-//					i2c.data = direction;
-					i2c.data = 0x05;
+					if(i2c.bit == 0) {
+						i2c.data = i2c_read_register();
+					}
 					write_bit = i2c.data >> (7 - i2c.bit);
 					write_bit = write_bit & 0x01;
 					PRINTD("wb %u\n", write_bit);
@@ -630,7 +736,7 @@ bool i2c_update_slave_state(transition_t transition) {
 			} // Else do nothing.
 		} else if(i2c.state == NO_STATE) {
 			i2c_data_high();
-			DrvADC_EnableAdcInt();				//enable ADC interrupt
+			dirDetectResume();					//enable ADC interrupt
 		}// Else do nothing.
 	} else if(transition == SDA_ROSE) {
 		PRINTD("sda /\\\n");
@@ -638,7 +744,7 @@ bool i2c_update_slave_state(transition_t transition) {
 		if(i2c.sck_pin == HIGH) {
 			PRINTD("stop condition\n");
 			i2c.state = NO_STATE;
-			DrvADC_EnableAdcInt();				//enable ADC interrupt
+			dirDetectResume();					//enable ADC interrupt
 		}
 	} else if(transition == SDA_FELL) {
 		PRINTD("sda \\/\n");
@@ -35,6 +35,26 @@ extern volatile INT32 direction;
 #define I2C_SCK_PIN					15
 #define I2C_SCK_MASK				(1 << I2C_SCK_PIN)
 
+// Registers a master selects by writing one byte before reading.  Reads
+// come from I2C_REG_DIRECTION until something else is selected, and from
+// it too when what is selected isn't a register this build reads.
+#define I2C_REG_DIRECTION			0x00	// the I2C_REG_TRACK byte (this used to read a fixed 0x05)
+#define I2C_REG_TRACK				0x01	// the strongest source's LED (1..12, 0 for none) in the low nibble, its confidence (0..15) in the high one
+#define I2C_REG_TRACK2				0x02	// the same for the second source
+#define I2C_REG_BEARING				0x03	// the I2C_REG_TRACK byte, then the strongest source's bearing in tenths of a degree clockwise from LED 12 (0..3599, 0xFFFF for none), low byte first; one byte per read, repeating
+#define I2C_REG_BEARING2			0x04	// the same for the second source
+#define I2C_REG_PROFILE				0x10	// the profiler table, one byte per read (see profileDumpByte())
+#define I2C_REG_PROFILE_RESET		0x11	// selecting this clears the profiler table (and the benchmark counts)
+#define I2C_REG_AGREEMENT			0x12	// DIRDETECT_BENCHMARK builds: sixteenths of the windows where SSD and DirDetect_Judge() picked the same LED
+#define I2C_REG_CALIBRATE			0x20	// selecting this starts the factory mic calibration (see dirDetectCalibrate()), reads give its E_DIRDETECT_CAL_STATE
+#define I2C_REG_CAPTURE				0x30	// DIRDETECT_CAPTURE builds: selecting this records the next sound to flash (see Capture.h), reads give the E_CAPTURE_STATE
+#define I2C_REG_CAPTURE_NOW			0x31	// the same, but recording starts straight away
+#define I2C_REG_CAPTURE_STOP		0x32	// selecting this ends the recording under way
+#define I2C_REG_STREAM				0x38	// DIRDETECT_AUDIO_STREAM builds: selecting this streams a mic (see AudioStream.h), reads give the audio packets, a byte at a time
+#define I2C_REG_STREAM_STOP			0x39	// selecting this stops the stream, reads give the packets dropped since the stream started, modulo 256
+#define I2C_REG_CLASS				0x40	// DIRDETECT_CLASSIFY builds: the E_DIRDETECT_CLASS of the last window loud enough to use
+#define I2C_REG_CLASS_POLICY		0x48	// selecting this ORed with a mask of DIRDETECT_CLASS_BIT()s (0x48..0x4F) estimates only those classes, reads give the mask
+
 
 /************************** Type Prototypes **************************/
 typedef enum pin_enum {
@@ -74,6 +94,7 @@ typedef struct _SoftI2C {
 	uint8_t address;
 	uint8_t data;
 	uint8_t direction_register;
+	uint8_t reg;
 } SoftI2C;
 
 typedef enum transition_enum {
@@ -22,6 +22,21 @@
 // Packet types.
 #define PACKET_TYPE_SERIAL		0
 #define PACKET_TYPE_COMMAND		1
+#define PACKET_TYPE_AUDIO		2
+
+// PACKET_TYPE_AUDIO packets each carry one IMA ADPCM block that decodes on
+// its own, so a dropped packet costs only its own samples.
+//
+// Byte    0        header
+//         1        sequence number, to find dropped packets
+//         2..3     first sample, little endian (the predictor)
+//         4        step index (0..88)
+//         5..19    samples after the first, two per byte, low nibble first
+#define PACKET_AUDIO_SEQUENCE		1
+#define PACKET_AUDIO_PREDICTOR		2
+#define PACKET_AUDIO_STEP_INDEX		4
+#define PACKET_AUDIO_DATA			5
+#define PACKET_AUDIO_SAMPLES		(1 + 2*(PACKET_BUF_LENGTH - PACKET_AUDIO_DATA))
 
 // Maximum amount of data to send in a packet.
 #define PACKET_BUF_LENGTH 		20
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <string.h>
+#include "Platform.h"
+#include "Driver/DrvCLK.h"
+#include "Driver/DrvTimer.h"
+#include "System/PerformEval.h"
+#include "Profile.h"
+
+#if PROFILE
+
+//
+// Local Variables and Defines
+//
+
+typedef struct {
+	UINT32 u32Count;
+	UINT32 u32Min;
+	UINT32 u32Max;
+	UINT64 u64Total;
+} S_PROFILE_ENTRY;
+
+static S_PROFILE_ENTRY s_asProfile[ePROFILE_COUNT];
+
+// Indexed by E_PROFILE_PROBE.
+static const char * const s_apszName[ePROFILE_COUNT] =
+{
+	"adc irq",
+	"process",
+	"estimate",
+	"find_phase_AB",
+	"find_phase_AC",
+	"find_phase_BC",
+	"determineDirection",
+	"gpab irq",
+	"sound decode",
+	"bench ssd",
+	"bench vendor",
+};
+
+static volatile UINT32 s_u32Wraps = 0;		// Timer2 periods since profileInit()
+
+// Byte stream state for profileDumpByte().  Each probe's stats are latched
+// when its first byte is read so the bytes of one probe belong together.
+static UINT16 s_u16DumpIndex = 0;
+static UINT8 s_au8DumpLatch[sizeof(S_PROFILE_STATS)];
+
+//
+// Local Functions
+//
+
+static void put_le32(UINT8 *pu8, UINT32 u32)
+{
+	pu8[0] = (UINT8) u32;
+	pu8[1] = (UINT8) (u32 >> 8);
+	pu8[2] = (UINT8) (u32 >> 16);
+	pu8[3] = (UINT8) (u32 >> 24);
+}
+
+//
+// IRQ Functions
+//
+
+void TMR2_IRQHandler(void)
+{
+	DrvTimer_ClearIntFlagTmr2();
+	s_u32Wraps++;
+}
+
+//
+// Global Functions
+//
+
+void profileInit(void)
+{
+	profileReset();
+	s_u32Wraps = 0;
+
+	// Free-running periodic count; the interrupt only counts wraps.  It
+	// gets the top priority so wraps are counted while other interrupts run.
+	_PERFORMEVAL_INIT_COUNT();
+	NVIC_SetPriority(TMR2_IRQn, 0);
+}
+
+void profileReset(void)
+{
+	int i;
+
+	__disable_irq();
+	memset(s_asProfile, 0, sizeof(s_asProfile));
+	for(i = 0; i<ePROFILE_COUNT; i++)
+		s_asProfile[i].u32Min = 0xFFFFFFFF;
+	__enable_irq();
+}
+
+UINT32 profileNow(void)
+{
+	UINT32 u32Primask = __get_PRIMASK();
+	UINT32 u32Wraps, u32Count;
+
+	__disable_irq();
+	u32Count = DrvTimer_GetClkCountTmr2();
+	u32Wraps = s_u32Wraps;
+
+	// The timer may have wrapped without its interrupt having run yet
+	// (interrupts are off here, and may have been before).  A small count
+	// with the flag still set means the wrap isn't in s_u32Wraps.
+	if (DrvTimer_GetIntFlagTmr2() && (u32Count < PROFILE_TIMER_PERIOD/2))
+		u32Wraps++;
+	__set_PRIMASK(u32Primask);
+
+	return u32Wraps*PROFILE_TIMER_PERIOD + u32Count;
+}
+
+void profileRecord(E_PROFILE_PROBE eProbe, UINT32 u32Start)
+{
+	UINT32 u32Cycles = profileNow() - u32Start;
+	UINT32 u32Primask = __get_PRIMASK();
+	S_PROFILE_ENTRY *psEntry = &s_asProfile[eProbe];
+
+	// A higher priority probe could update the same entry half way through.
+	__disable_irq();
+	psEntry->u32Count++;
+	psEntry->u64Total += u32Cycles;
+	if (psEntry->u32Min > u32Cycles)
+		psEntry->u32Min = u32Cycles;
+	if (psEntry->u32Max < u32Cycles)
+		psEntry->u32Max = u32Cycles;
+	__set_PRIMASK(u32Primask);
+}
+
+void profileGetStats(E_PROFILE_PROBE eProbe, S_PROFILE_STATS *psStats)
+{
+	S_PROFILE_ENTRY sEntry;
+	UINT32 u32Primask = __get_PRIMASK();
+
+	__disable_irq();
+	sEntry = s_asProfile[eProbe];
+	__set_PRIMASK(u32Primask);
+
+	psStats->u32Count = sEntry.u32Count;
+	psStats->u32Min = sEntry.u32Count ? sEntry.u32Min : 0;
+	psStats->u32Max = sEntry.u32Max;
+	psStats->u32Mean = sEntry.u32Count ? (UINT32) (sEntry.u64Total/sEntry.u32Count) : 0;
+}
+
+const char *profileGetName(E_PROFILE_PROBE eProbe)
+{
+	return s_apszName[eProbe];
+}
+
+void profilePrint(void)
+{
+	S_PROFILE_STATS sStats;
+	int i;
+
+	printf("%-20s %10s %8s %8s %8s (cycles at %u MHz)\n", "probe", "count", "min", "mean", "max", PROFILE_TIMER_HZ/1000000);
+	for(i = 0; i<ePROFILE_COUNT; i++) {
+		profileGetStats((E_PROFILE_PROBE) i, &sStats);
+		printf("%-20s %10u %8u %8u %8u\n", s_apszName[i], sStats.u32Count, sStats.u32Min, sStats.u32Mean, sStats.u32Max);
+	}
+}
+
+void profileDumpStart(void)
+{
+	s_u16DumpIndex = 0;
+}
+
+UINT8 profileDumpByte(void)
+{
+	UINT16 u16Offset;
+	UINT8 u8Byte;
+
+	if (s_u16DumpIndex == 0)
+		u8Byte = ePROFILE_COUNT;
+	else {
+		u16Offset = (s_u16DumpIndex - 1) % sizeof(S_PROFILE_STATS);
+		if (u16Offset == 0) {
+			S_PROFILE_STATS sStats;
+
+			profileGetStats((E_PROFILE_PROBE) ((s_u16DumpIndex - 1)/sizeof(S_PROFILE_STATS)), &sStats);
+			put_le32(&s_au8DumpLatch[0], sStats.u32Count);
+			put_le32(&s_au8DumpLatch[4], sStats.u32Min);
+			put_le32(&s_au8DumpLatch[8], sStats.u32Max);
+			put_le32(&s_au8DumpLatch[12], sStats.u32Mean);
+		}
+		u8Byte = s_au8DumpLatch[u16Offset];
+	}
+
+	if (++s_u16DumpIndex >= PROFILE_DUMP_SIZE)
+		s_u16DumpIndex = 0;
+	return u8Byte;
+}
+
+#endif // PROFILE
@@ -0,0 +1,88 @@
+#ifndef __PROFILE_H
+#define __PROFILE_H
+
+#include "Platform.h"
+
+//
+// Global Defines and Declarations
+//
+
+// Cycle profiler.  Timer2 free-runs from the 48MHz clock (see
+// System/PerformEval.h) and each probe records the time between its start
+// and end, so a stage that gets interrupted includes the interrupt.  The
+// profiler owns TMR2_IRQHandler, so nothing else may use Timer2 once
+// profileInit() has run.
+//
+// The probes are off unless the project defines PROFILE=1 and builds
+// Profile.c; shared code such as Sound.c includes this header too, and with
+// PROFILE 0 it needs nothing from Profile.c.
+#ifndef PROFILE
+#define PROFILE 0 // 1 builds the probes in (about 280 bytes of RAM)
+#endif
+
+#define PROFILE_TIMER_PERIOD		65535	// counts per Timer2 wrap, as in PerformEval.h
+#define PROFILE_TIMER_HZ			48000000
+
+typedef enum {
+	ePROFILE_ADC_IRQ,				// ADC_IRQHandler
+	ePROFILE_PROCESS,				// one hop of direction processing (thread or interrupt), all of it
+	ePROFILE_ESTIMATE,				// cost curves of the selected estimator
+	ePROFILE_FIND_PHASE_AB,
+	ePROFILE_FIND_PHASE_AC,
+	ePROFILE_FIND_PHASE_BC,
+	ePROFILE_DETERMINE_DIRECTION,
+	ePROFILE_GPAB_IRQ,				// bit-banged I2C slave
+	ePROFILE_SOUND_DECODE,			// one NuSoundEx buffer
+	ePROFILE_BENCH_SSD,				// DIRDETECT_BENCHMARK's two estimators on the same window
+	ePROFILE_BENCH_VENDOR,
+	ePROFILE_COUNT
+} E_PROFILE_PROBE;
+
+typedef struct {
+	UINT32 u32Count;
+	UINT32 u32Min;					// cycles
+	UINT32 u32Max;
+	UINT32 u32Mean;
+} S_PROFILE_STATS;
+
+// Wrap a stage in PROFILE_START(u32Start) ... PROFILE_END(eProbe, u32Start),
+// where u32Start is a local UINT32.
+#if PROFILE
+#define PROFILE_START(u32Start)			((u32Start) = profileNow())
+#define PROFILE_END(eProbe, u32Start)	profileRecord((eProbe), (u32Start))
+#else
+#define PROFILE_START(u32Start)			((u32Start) = 0)
+#define PROFILE_END(eProbe, u32Start)	((void) (u32Start))
+#endif
+
+// Bytes profileDumpByte() returns for one pass over the table: the number
+// of probes, then count, min, max and mean for each probe, little endian.
+#define PROFILE_DUMP_SIZE			(1 + ePROFILE_COUNT*sizeof(S_PROFILE_STATS))
+
+//
+// Global Functions
+//
+
+// Start Timer2 and clear the table.  Call after anything that borrows
+// Timer2 for a delay (e.g. dirDetectInit()).
+void profileInit(void);
+void profileReset(void);
+
+// Timer2 count since profileInit().
+UINT32 profileNow(void);
+
+// Add one run of eProbe that started at u32Start.
+void profileRecord(E_PROFILE_PROBE eProbe, UINT32 u32Start);
+
+void profileGetStats(E_PROFILE_PROBE eProbe, S_PROFILE_STATS *psStats);
+const char *profileGetName(E_PROFILE_PROBE eProbe);
+
+// Print the table with printf.
+void profilePrint(void);
+
+// Read the table a byte at a time (for the I2C slave).  profileDumpStart()
+// rewinds to the first byte; after the last one the dump starts over.
+void profileDumpStart(void);
+UINT8 profileDumpByte(void);
+
+#endif // __PROFILE_H
@@ -7,6 +7,7 @@
 #include "Audio/NuDACFilterEx.h"
 #include "SpiFS.h"
 #include "Sound.h"
+#include "Profile.h"
 
 //
 // Global Variables
@@ -107,6 +108,7 @@ static UINT32 soundEventCallback(UINT16 eventIndex, UINT16 eventSubIndex)
 static BOOL soundFillPCMBuffers(void)
 {
 	BOOL stopPlaying = FALSE;
+	UINT32 u32Profile;
 
 	// We fill up as many buffers as we can before we hit the read buffer.
 	while (!stopPlaying && (pcmBufferDecodeIndex != pcmBufferPlaybackIndex))
@@ -115,7 +117,9 @@ static BOOL soundFillPCMBuffers(void)
 		if (!NuSoundEx_DecodeIsEnd((UINT8 *) &decodeWorkBuf))
 		{
 			// Decode the next audio buffer.
+			PROFILE_START(u32Profile);
 			while (NuSoundEx_DecodeProcess(decodeWorkBuf, decodeTempBuf, pcmBufferData[pcmBufferDecodeIndex], soundDataCallback, soundEventCallback) == 0 );
+			PROFILE_END(ePROFILE_SOUND_DECODE, u32Profile);
 
 			// Mark this buffer as now ready to be played.
 			pcmBufferReadyFlag[pcmBufferDecodeIndex] = TRUE;
@@ -32,6 +32,9 @@
 #define SPIFS_FILEID_VALID(fid) \
 		((fid >= SPIFS_SECTOR_FIRST) && (fid < SPIFS_SECTOR_COUNT))
 
+// Pages in a sector.
+#define SPIFS_SECTOR_PAGES			(SPIFS_SECTOR_SIZE / SPIFS_PAGE_SIZE)
+
 // Returns TRUE if block size is valid.
 #define SPIFS_BLOCKSIZE_VALID(bs) \
 		((bs > 0) && (bs <= SPIFS_BLOCK_SIZE))
@@ -49,6 +52,10 @@ typedef __packed struct _SPIFS_FILE_BLOCK
   INT16 nextId;
 } SPIFS_FILE_BLOCK;
 
+// The flash as an open stream uses it.  The page programs copy the handler,
+// but the stream still reads block headers through it.
+static S_SPIFLASH_HANDLER spiStreamHandler;
+
 // Cleans the filename of problem characters.
 static int CleanFilename(const char *src, char *dst)
 {
@@ -163,7 +170,7 @@ static INT16 spiFSFreeBlock(S_SPIFLASH_HANDLER *spiFlashHandler)
 		SPIFlash_Read(spiFlashHandler, sectorOffset, (PUINT8) &fileBlock, sizeof(fileBlock));
 
 		// Is this a free sector?  This is indicated with an invalid fileid.
-		if (!SPIFS_FILEID_VALID(fileBlock.blockId))
+		if (!SPIFS_FILEID_VALID(fileBlock.fileId))
 		{
 			// Make sure the block appears erased.  This will hopefully 
 			// help reduce instances of a corrupt file system.
@@ -821,3 +828,303 @@ BOOL spiFSReadDir(SPIFS_DIR *dir)
 	return retval;
 }
 
+
+// Returns the offset within its sector of the next byte the stream takes.
+static UINT16 spiFSStreamOffset(SPIFS_STREAM *stream)
+{
+	return SPIFS_HEADER_SIZE + stream->file.blockIndex;
+}
+
+// Returns the offset within its sector of the first byte of data in the
+// page being filled.
+static UINT16 spiFSStreamPageStart(SPIFS_STREAM *stream)
+{
+	UINT16 start;
+
+	// Start of the page.
+	start = spiFSStreamOffset(stream) & ~(SPIFS_PAGE_SIZE - 1);
+
+	// The first page of a block begins with the block header, and the first
+	// block in a file with the filename too.
+	if (start == 0)
+		start = SPIFS_HEADER_SIZE + ((stream->file.blockId == 0) ? SPIFS_FILENAME_LEN : 0);
+
+	return start;
+}
+
+BOOL spiFSStreamOpen(const char *filename, INT16 sectors, SPIFS_STREAM *stream)
+{
+	INT16 fileId;
+	INT16 sectorId;
+	INT16 blockId;
+	UINT32 sectorOffset;
+	char cleanname[SPIFS_FILENAME_LEN];
+
+	// Initialize the stream structure.
+	memset(stream, 0, sizeof(SPIFS_STREAM));
+
+	// Clean the filename of problem characters.
+	if (!CleanFilename(filename, cleanname)) return FALSE;
+
+	// Wait for exclusive access to the SPI master bus.  We keep it until the
+	// stream is closed.
+	osMutexWait(spiMasterMutex, osWaitForever);
+
+	// Open the SPI flash device.
+	SPIFlash_Open(SPI_FLASH_HANDLER, SPI_FLASH_DEVICE, SPI_FLASH_DIVIDER, &spiStreamHandler);
+
+	// Erase each fileblock associated with any existing file.
+	fileId = spiFSFindFilename(&spiStreamHandler, cleanname);
+	if (SPIFS_FILEID_VALID(fileId)) spiFSEraseBlocks(&spiStreamHandler, fileId);
+
+	// Claim the sectors, linking each to the one before.  The block sizes
+	// stay erased until the stream is closed.
+	fileId = -1;
+	sectorId = -1;
+	for (blockId = 0; blockId < sectors; ++blockId)
+	{
+		INT16 nextId;
+
+		// Find a free sector.
+		nextId = spiFSFreeBlock(&spiStreamHandler);
+		if (!SPIFS_FILEID_VALID(nextId)) break;
+
+		// The first sector id is the file id.
+		if (blockId == 0) fileId = nextId;
+
+		// Get the byte offset of the new sector.
+		sectorOffset = SPIFS_SECTORID_TO_BYTEOFFSET(nextId);
+
+		// Write the file id and the block id, which takes the sector.
+		SPIFlash_Write(&spiStreamHandler, sectorOffset + SPIFS_FILEID_OFFSET, (PUINT8) &fileId, sizeof(INT16));
+		SPIFlash_Write(&spiStreamHandler, sectorOffset + SPIFS_BLOCKID_OFFSET, (PUINT8) &blockId, sizeof(INT16));
+
+		// Write the file name into the first sector, else link the sector
+		// before to this one.
+		if (blockId == 0)
+			SPIFlash_Write(&spiStreamHandler, sectorOffset + SPIFS_FILENAME_OFFSET, (PUINT8) cleanname, SPIFS_FILENAME_LEN);
+		else
+			SPIFlash_Write(&spiStreamHandler, SPIFS_SECTORID_TO_BYTEOFFSET(sectorId) + SPIFS_NEXTID_OFFSET, (PUINT8) &nextId, sizeof(INT16));
+
+		sectorId = nextId;
+	}
+
+	// Give up the bus if not even one sector was free.
+	if (!SPIFS_FILEID_VALID(fileId))
+	{
+		SPIFlash_Close(&spiStreamHandler);
+		osMutexRelease(spiMasterMutex);
+		return FALSE;
+	}
+
+	// Prepare the stream for writing.  The first page starts after the
+	// block header and the filename.
+	stream->file.write = TRUE;
+	stream->file.fileId = fileId;
+	stream->file.blockId = 0;
+	stream->file.blockIndex = SPIFS_FILENAME_LEN;
+	stream->file.blockSize = SPIFS_FILENAME_LEN;
+	stream->file.thisId = fileId;
+	stream->file.nextId = -1;
+	stream->file.position = SPIFS_FILENAME_LEN;
+	stream->blockCount = blockId;
+
+	// Anything left erased in a page is left alone when it is programmed,
+	// which is what keeps the block headers intact.
+	memset(stream->page, 0xff, sizeof(stream->page));
+
+	return TRUE;
+}
+
+UINT16 spiFSStreamSpace(SPIFS_STREAM *stream)
+{
+	UINT16 space;
+	UINT16 offset;
+
+	// Nothing fits once the claimed sectors are full.
+	if (stream->file.blockId >= stream->blockCount) return 0;
+
+	// Room left in the page being filled.
+	offset = spiFSStreamOffset(stream);
+	space = SPIFS_PAGE_SIZE - (offset & (SPIFS_PAGE_SIZE - 1));
+
+	// The page can only be finished if the other buffer is free to take
+	// over, and then there is a whole page more, less the block header if
+	// that page starts the next block.
+	if (stream->queued || stream->writing)
+		space -= 1;
+	else if ((offset + space) < SPIFS_SECTOR_SIZE)
+		space += SPIFS_PAGE_SIZE;
+	else if ((stream->file.blockId + 1) < stream->blockCount)
+		space += SPIFS_PAGE_SIZE - SPIFS_HEADER_SIZE;
+
+	return space;
+}
+
+UINT32 spiFSStreamLeft(SPIFS_STREAM *stream)
+{
+	// The first block's size counts the filename, as the position does.
+	return ((UINT32) stream->blockCount * SPIFS_BLOCK_SIZE) - stream->file.position;
+}
+
+BOOL spiFSStreamWrite(SPIFS_STREAM *stream, const UINT8 *buffer, UINT16 count)
+{
+	UINT16 offset;
+	UINT16 byteCount;
+
+	// Return error if it won't all fit.
+	if (count > spiFSStreamSpace(stream)) return FALSE;
+
+	// Keep going while there is data left to write.
+	while (count > 0)
+	{
+		// Copy as much as fits in the page being filled.
+		offset = spiFSStreamOffset(stream) & (SPIFS_PAGE_SIZE - 1);
+		byteCount = SPIFS_PAGE_SIZE - offset;
+		if (byteCount > count) byteCount = count;
+		memcpy((UINT8 *) stream->page[stream->fill] + offset, buffer, byteCount);
+
+		// Adjust the buffers, indices and counts.
+		count -= byteCount;
+		buffer += byteCount;
+		stream->file.blockIndex += byteCount;
+		stream->file.blockSize = stream->file.blockIndex;
+		stream->file.position += byteCount;
+
+		// Is the page full?
+		if ((offset + byteCount) == SPIFS_PAGE_SIZE)
+		{
+			// Queue it for the flash and fill the other buffer.
+			stream->queued = TRUE;
+			stream->fill ^= 1;
+			memset(stream->page[stream->fill], 0xff, SPIFS_PAGE_SIZE);
+
+			// Move on to the next block once this one is full.
+			if (stream->file.blockIndex >= SPIFS_BLOCK_SIZE)
+			{
+				stream->file.blockId += 1;
+				stream->file.blockIndex = 0;
+				stream->file.blockSize = 0;
+			}
+
+			// Start programming it if we can.
+			spiFSStreamPoll(stream);
+		}
+	}
+
+	return TRUE;
+}
+
+void spiFSStreamPoll(SPIFS_STREAM *stream)
+{
+	E_SPIFLASH_STATE state;
+	SPIFS_FILE_BLOCK fileBlock;
+
+	// Is the flash still busy with the last page?
+	if (stream->writing)
+	{
+		state = SPIFlash_GetState_NBK();
+		if ((state != eSPIFLASH_WRITE_SUCCESS) && (state != eSPIFLASH_IDLE_STATE)) return;
+		stream->writing = FALSE;
+	}
+
+	// Return if there is no page waiting.
+	if (!stream->queued) return;
+
+	// Move on to the next sector once the pages of this one are written.
+	// The flash isn't busy, so the block header can be read.
+	if (stream->writePage >= SPIFS_SECTOR_PAGES)
+	{
+		SPIFlash_Read(&spiStreamHandler, SPIFS_SECTORID_TO_BYTEOFFSET(stream->file.thisId), (PUINT8) &fileBlock, sizeof(fileBlock));
+		stream->file.thisId = fileBlock.nextId;
+		stream->writePage = 0;
+	}
+
+	// Start programming the page.
+	SPIFlash_WritePage_NBK(&spiStreamHandler,
+		SPIFS_SECTORID_TO_BYTEOFFSET(stream->file.thisId) + ((UINT32) stream->writePage * SPIFS_PAGE_SIZE),
+		(PUINT8) stream->page[stream->fill ^ 1]);
+	stream->writePage += 1;
+	stream->queued = FALSE;
+	stream->writing = TRUE;
+}
+
+BOOL spiFSStreamClose(SPIFS_STREAM *stream)
+{
+	INT16 blockId;
+	INT16 blockSize;
+	INT16 sectorId;
+	INT16 zero;
+	UINT32 sectorOffset;
+	SPIFS_FILE_BLOCK fileBlock;
+
+	// Return if stream isn't open.
+	if (!SPIFS_FILEID_VALID(stream->file.fileId)) return FALSE;
+
+	// Queue the page being filled if anything is in it.  The rest of it
+	// stays erased.
+	if ((stream->file.blockId < stream->blockCount) &&
+			(spiFSStreamOffset(stream) != spiFSStreamPageStart(stream)))
+	{
+		// Wait for the other buffer to be free.
+		while (stream->queued || stream->writing) spiFSStreamPoll(stream);
+
+		stream->queued = TRUE;
+		stream->fill ^= 1;
+	}
+
+	// Wait for the flash to take the pages.
+	while (stream->queued || stream->writing) spiFSStreamPoll(stream);
+
+	// The last block with data in it.
+	blockId = stream->file.blockId;
+	if ((blockId >= stream->blockCount) || ((stream->file.blockIndex == 0) && (blockId > 0))) blockId -= 1;
+
+	// Write the block sizes, end the file at the last block with data and
+	// give back the sectors after it.
+	zero = 0;
+	sectorId = stream->file.fileId;
+	while (SPIFS_SECTORID_VALID(sectorId))
+	{
+		// Get the byte offset of the sector.
+		sectorOffset = SPIFS_SECTORID_TO_BYTEOFFSET(sectorId);
+
+		// Read the fileblock at the start of the sector.
+		SPIFlash_Read(&spiStreamHandler, sectorOffset, (PUINT8) &fileBlock, sizeof(fileBlock));
+
+		if (fileBlock.blockId < blockId)
+		{
+			// A full block.
+			blockSize = SPIFS_BLOCK_SIZE;
+			SPIFlash_Write(&spiStreamHandler, sectorOffset + SPIFS_BLOCKSIZE_OFFSET, (PUINT8) &blockSize, sizeof(INT16));
+		}
+		else if (fileBlock.blockId == blockId)
+		{
+			// The last block.  Its size is what was filled, and clearing its
+			// next id ends the file.
+			blockSize = (blockId == stream->file.blockId) ? stream->file.blockIndex : SPIFS_BLOCK_SIZE;
+			SPIFlash_Write(&spiStreamHandler, sectorOffset + SPIFS_BLOCKSIZE_OFFSET, (PUINT8) &blockSize, sizeof(INT16));
+			if (SPIFS_SECTORID_VALID(fileBlock.nextId))
+				SPIFlash_Write(&spiStreamHandler, sectorOffset + SPIFS_NEXTID_OFFSET, (PUINT8) &zero, sizeof(INT16));
+		}
+		else
+		{
+			// Not used.
+			SPIFlash_Erase4K(&spiStreamHandler, (UINT16) sectorId, 1);
+		}
+
+		// Set the sector id to the next sector id.
+		sectorId = fileBlock.nextId;
+	}
+
+	// Close the SPI flash device.
+	SPIFlash_Close(&spiStreamHandler);
+
+	// Release exclusive access to the SPI master bus.
+	osMutexRelease(spiMasterMutex);
+
+	// Clear the stream structure.
+	memset(stream, 0, sizeof(SPIFS_STREAM));
+
+	return TRUE;
+}
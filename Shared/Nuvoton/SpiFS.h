@@ -14,6 +14,7 @@
 #define SPI_SFLASH_DO_PIN				DRVGPIO_PIN_4
 
 #define SPIFS_FILENAME_LEN      16
+#define SPIFS_PAGE_SIZE					256		// Size of a flash program page.
 
 // SPI file structure.
 typedef struct _SPIFS_FILE
@@ -36,6 +37,22 @@ typedef struct _SPIFS_DIR
 	char fileName[SPIFS_FILENAME_LEN];
 } SPIFS_DIR;
 
+// SPI file stream structure.  A stream is a file opened for writing with
+// all of its sectors claimed up front, so nothing but page programs is left
+// to do while it is written, and those are started without waiting on the
+// flash.  The file's blockId, blockIndex and position say where the next
+// byte goes; thisId is the sector the next full page is programmed into.
+typedef struct _SPIFS_STREAM
+{
+  SPIFS_FILE file;
+	INT16 blockCount;			// sectors claimed
+	UINT8 writePage;			// page of sector thisId the next full page goes to
+	UINT8 fill;					// page buffer being filled
+	BOOL queued;				// the other page buffer is full and waiting for the flash
+	BOOL writing;				// the other page buffer is being programmed
+	UINT32 page[2][SPIFS_PAGE_SIZE/4];	// word aligned for the burst writes
+} SPIFS_STREAM;
+
 //
 // Global Functions
 //
@@ -54,6 +71,30 @@ BOOL spiFSOpenDir(SPIFS_DIR *dir);
 BOOL spiFSCloseDir(SPIFS_DIR *dir);
 BOOL spiFSReadDir(SPIFS_DIR *dir);
 
+// Streams hold the SPI master bus from spiFSStreamOpen() to
+// spiFSStreamClose(), and only one can be open.  The page programs are
+// interrupt driven, so SPI0_IRQHandler has to call SPIFlash_ISR_NBK() while
+// one is.  Opening erases any file of the same name and claims up to
+// sectors sectors, fewer if the flash is fuller than that, which takes a
+// while; closing gives back the ones that weren't used.
+BOOL spiFSStreamOpen(const char *filename, INT16 sectors, SPIFS_STREAM *stream);
+BOOL spiFSStreamClose(SPIFS_STREAM *stream);
+
+// Bytes spiFSStreamWrite() can take now.  Zero once the claimed sectors are
+// full.
+UINT16 spiFSStreamSpace(SPIFS_STREAM *stream);
+
+// Bytes left in the claimed sectors.
+UINT32 spiFSStreamLeft(SPIFS_STREAM *stream);
+
+// Copy count bytes into the stream.  Nothing is taken and FALSE returned
+// if they don't all fit (see spiFSStreamSpace()).  Never waits on the flash.
+BOOL spiFSStreamWrite(SPIFS_STREAM *stream, const UINT8 *buffer, UINT16 count);
+
+// Start programming the next full page if the flash is done with the last
+// one.  spiFSStreamWrite() does this too.
+void spiFSStreamPoll(SPIFS_STREAM *stream);
+
 #endif // __SPIFS_H
 
 